@@ -7,6 +7,84 @@
 //# Write + Read + Verify in one shot
 //./snb_dit /tmp/testfile.bin 4096 readwrite 0xDEADBEEF
 
+//# Sweep queue depth x block size, 5 sec per point, table + CSV
+//./snb_dit /tmp/testfile.bin 1073741824 sweep 0xDEADBEEF --rw=randread --qd=1,4,16 --bs=4k,64k --csv=sweep.csv
+
+//# Open-loop: issue 20000 IOPS on schedule, latency measured from intended issue time
+//./snb_dit /tmp/testfile.bin 1073741824 sweep 0xDEADBEEF --rw=randread --qd=32 --bs=4k --rate=20000
+
+//# Write + verify with 4 workers, 1 sec interval stats, JSON report
+//./snb_dit /tmp/testfile.bin 1073741824 readwrite 0xDEADBEEF --qd=4 --bs=1m --interval=1 --format=json --output=run.json
+
+//# Copy offload: write source, copy_file_range it in 16 MB chunks with 4 threads, verify copy
+//./snb_dit /tmp/testfile.bin 1073741824 copy 0xDEADBEEF --dest=/tmp/copy.bin --bs=16m --qd=4
+
+//# Burn-in: 8 write+verify passes rotating hex, complement, walking ones and random patterns
+//./snb_dit /tmp/testfile.bin 1073741824 burnin 0xDEADBEEF --passes=8 --patterns=hex,inv,walk,rand
+
+//# Keep going on I/O errors: retry, isolate bad sectors, verify around them, print the error map
+//./snb_dit /dev/sdX 1073741824 readwrite 0xDEADBEEF --on-error=continue --retries=3 --retry-delay=10
+
+//# Bad-block map out of a verify pass, fed back in as a skip list on the next run
+//./snb_dit /dev/sdX 1073741824 read 0xDEADBEEF --on-error=continue --badblocks-out=bad.txt
+//./snb_dit /dev/sdX 1073741824 readwrite 0xDEADBEEF --skip=bad.txt
+
+//# Random writes cover only part of the file: verify just the written blocks, later too
+//./snb_dit /tmp/testfile.bin 1073741824 write 0xDEADBEEF --rw=randwrite --bs=64k --bitmap=written.map
+//./snb_dit /tmp/testfile.bin 1073741824 read 0xDEADBEEF --bitmap=written.map
+
+//# Host vs device vs NAND bytes written and write amplification per phase
+//./snb_dit /dev/nvme0n1 1073741824 write 0xDEADBEEF --rw=randwrite --bs=4k --qd=16 --device-stats
+
+//# Kernel view (diskstats) next to the tool's own numbers every second
+//./snb_dit /dev/sdX 1073741824 readwrite 0xDEADBEEF --qd=8 --bs=128k --interval=1 --device-stats
+
+//# Capture every I/O slower than 2 ms (offset, time, queue depth); kill -USR1 dumps it live
+//./snb_dit /dev/sdX 1073741824 sweep 0xDEADBEEF --rw=randread --qd=32 --bs=4k --slow=2000 --slow-out=slow.txt
+
+//# Binary trace of every I/O, then decode it to CSV plus latency histograms
+//./snb_dit /dev/sdX 1073741824 sweep 0xDEADBEEF --rw=randread --qd=32 --bs=4k --trace=run.trc
+//./snb_dit decode run.trc run.csv
+
+//# Force the clock source used for latency (default: TSC if invariant and calibrated)
+//./snb_dit /dev/sdX 1073741824 sweep 0xDEADBEEF --rw=randread --qd=1 --bs=4k --clock=raw
+
+//# Throughput / latency heatmap over 64 LBA regions for the write and read phases
+//./snb_dit /dev/sdX 1073741824 readwrite 0xDEADBEEF --bs=1m --regions=64 --heatmap=heat.csv
+
+//# Surface scan: 4 MB sequential reads, slow blocks re-read per sector and graded by latency
+//./snb_dit /dev/sdX 1073741824 scan 0 --classes=5,50,500 --badblocks-out=bad.txt
+
+//# SNIA PTS steady state: 2x sequential precondition, then 60 s rounds of 4k random writes
+//./snb_dit /dev/nvme0n1 1073741824 steady 0xDEADBEEF --rw=randwrite --bs=4k --qd=32 --runtime=60
+
+//# Performance gate: exit 3 if any phase or 1 s interval misses 200 MB/s or p99 <= 2 ms
+//./snb_dit /dev/sdX 1073741824 readwrite 0xDEADBEEF --qd=4 --bs=1m --interval=1 --min-mbps=200 --max-p99=2000
+
+//# Five runs with cache drop and 10 s cooldown between them: mean, stddev, range, 95% CI
+//./snb_dit /tmp/testfile.bin 1073741824 readwrite 0xDEADBEEF --bs=1m --repeat=5 --drop-caches --cooldown=10
+
+//# Compare two JSON reports (e.g. before/after a kernel upgrade); exit 3 on a significant regression
+//./snb_dit compare old.json new.json --threshold=5
+
+//# Find the queue depth (up to 128) with the most IOPS while p99 stays under 500 us
+//./snb_dit /dev/nvme0n1 1073741824 tune 0xDEADBEEF --rw=randread --bs=4k --qd=128 --target-p99=500 --runtime=60
+
+//# Per-core io_uring scaling: 1, 2, 4 and 8 pinned cores, each with its own ring, buffers and LBA slice
+//./snb_dit /dev/nvme0n1 1073741824 cores 0xDEADBEEF --rw=randread --bs=4k --qd=32 --cores=1,2,4,8
+
+//# Full write + verify on 4 cores (io_uring, 16 in flight each), 8 MB work units stolen by idle cores
+//./snb_dit /dev/md0 1073741824 readwrite 0xDEADBEEF --bs=1m --qd=16 --cores=4 --steal-unit=8m
+
+//# Every 4k write linked to a read-back in the kernel (IOSQE_IO_LINK): verified data, chain latency
+//./snb_dit /dev/nvme0n1 1073741824 write 0xDEADBEEF --bs=4k --qd=32 --link=read
+
+//# Deep-queue verify with 32 kernel-selected buffers per core instead of one per I/O (256)
+//./snb_dit /dev/nvme0n1 1073741824 read 0xDEADBEEF --bs=128k --qd=256 --buf-ring=32
+
+//# O_DIRECT vs buffered vs uncached buffered (RWF_DONTCACHE): throughput and page cache footprint
+//./snb_dit /mnt/xfs/testfile.bin 4294967296 cache 0xDEADBEEF --bs=1m --qd=4
+
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,11 +95,42 @@
 #include <stdint.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/ioctl.h>
+#include <sys/sysmacros.h>
+#include <linux/fs.h>
+#include <linux/nvme_ioctl.h>
 #include <time.h>
+#include <math.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+#ifndef RWF_DONTCACHE
+#define RWF_DONTCACHE 0x00000080     /* Linux 6.14: buffered, dropped after writeback */
+#endif
 
 #define ALIGNMENT   512              /* O_DIRECT requires 512-byte aligned buffers */
 #define MB          (1024*1024)      /* 1 Megabyte */
 #define CHUNK_SIZE  (4 * 1024 * 1024) /* 4 MB reusable chunk buffer */
+#define MAX_SWEEP   32               /* max entries in a --qd / --bs list */
+#define MAX_QD      1024             /* max worker threads per job */
+#define MAX_CLASSES 8                /* max scan latency classes */
+#define SS_RANGE    0.20             /* steady state: max (max - min) / avg over the window */
+#define SS_SLOPE    0.10             /* steady state: max fitted excursion / avg over the window */
+
+/* Exit status: EXIT_SUCCESS, EXIT_FAILURE (I/O or usage error), then these */
+#define EXIT_VERIFY 2                /* data mismatch */
+#define EXIT_SLO    3                /* a performance threshold was missed */
 
 /* Structure to hold the hex pattern tightly packed */
 typedef struct __attribute__((packed)) {
@@ -60,6 +169,79 @@ static void fill_buffer(uint8_t *buf, size_t size, const HexPattern *pat) {
     }
 }
 
+/* xorshift64* - cheap per-thread PRNG for random offsets */
+static uint64_t rng_next(uint64_t *s) {
+    uint64_t x = *s;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *s = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+/*
+ * Data patterns. PAT_HEX is the packed HexPattern written by the plain
+ * write mode; the others exist so burn-in passes flip every bit that the
+ * previous pass left unchanged:
+ *   inv  - bitwise complement of the HexPattern layout
+ *   walk - 64-bit words with a single 1 bit walking across the word
+ *   rand - xorshift stream from a seed
+ */
+typedef enum { PAT_HEX, PAT_INV, PAT_WALK, PAT_RAND } PatternKind;
+
+#define PAT_KINDS 4
+
+static const char *pattern_names[] = { "hex", "inv", "walk", "rand" };
+
+/* Fill CHUNK_SIZE bytes of buf with pattern kind; seed varies walk/rand per pass */
+static void fill_pattern(uint8_t *buf, PatternKind kind, const HexPattern *pat, uint64_t seed) {
+    uint64_t *words = (uint64_t *)buf;
+    size_t    n     = CHUNK_SIZE / sizeof(uint64_t);
+    uint64_t  state = seed ? seed : 0x9E3779B97F4A7C15ull;
+
+    switch (kind) {
+    case PAT_HEX:
+        fill_buffer(buf, CHUNK_SIZE, pat);
+        break;
+    case PAT_INV:
+        fill_buffer(buf, CHUNK_SIZE, pat);
+        for (size_t i = 0; i < n; i++) words[i] = ~words[i];
+        break;
+    case PAT_WALK:
+        for (size_t i = 0; i < n; i++) words[i] = 1ull << ((i + seed) % 64);
+        break;
+    case PAT_RAND:
+        for (size_t i = 0; i < n; i++) words[i] = rng_next(&state);
+        break;
+    }
+}
+
+/*
+ * Build the pattern image used by the engine: CHUNK_SIZE bytes filled exactly
+ * like the legacy write chunk, followed by `extra` bytes that continue it
+ * periodically. File offset X always holds pat_img[X % CHUNK_SIZE], so any
+ * block of up to `extra` bytes is a contiguous slice of the image and the
+ * on-disk layout matches a plain write of 4 MB chunks.
+ */
+static uint8_t *build_image(PatternKind kind, const HexPattern *pat, uint64_t seed, size_t extra) {
+    uint8_t *img = NULL;
+    if (posix_memalign((void **)&img, ALIGNMENT, CHUNK_SIZE + extra) != 0) {
+        perror("posix_memalign (pattern)");
+        exit(EXIT_FAILURE);
+    }
+    fill_pattern(img, kind, pat, seed);
+    for (size_t done = 0; done < extra; ) {
+        size_t n = extra - done < (size_t)CHUNK_SIZE ? extra - done : (size_t)CHUNK_SIZE;
+        memcpy(img + CHUNK_SIZE + done, img, n);
+        done += n;
+    }
+    return img;
+}
+
+static uint8_t *build_pattern_image(const HexPattern *pat, size_t extra) {
+    return build_image(PAT_HEX, pat, 0, extra);
+}
+
 /* Print first N bytes of buffer as hex */
 static void dump_hex(const uint8_t *buf, size_t len, const char *label) {
     printf("%s (first %zu bytes):\n  ", label, len > 32 ? 32 : len);
@@ -71,11 +253,95 @@ static void dump_hex(const uint8_t *buf, size_t len, const char *label) {
     printf("\n");
 }
 
+/*
+ * Timing: every latency and throughput figure goes through get_time_ns().
+ * With an invariant TSC it is one rdtscp and a 64x64 multiply; otherwise
+ * CLOCK_MONOTONIC_RAW. Both count integer nanoseconds from the same origin
+ * (the TSC is anchored to CLOCK_MONOTONIC_RAW at calibration), so they can
+ * be mixed freely. clock_init() measures the TSC rate twice and keeps
+ * CLOCK_MONOTONIC_RAW if the two disagree or the TSC is not invariant.
+ */
+static struct {
+    int      tsc;        /* get_time_ns() reads the TSC */
+    uint64_t tsc0;       /* anchor: TSC value ... */
+    uint64_t ns0;        /* ... and CLOCK_MONOTONIC_RAW ns at the same instant */
+    uint64_t mult;       /* ns per tick, 32.32 fixed point */
+    double   ghz;
+} clk;
+
+static uint64_t raw_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Get current time in nanoseconds, for per-I/O latency */
+static inline uint64_t get_time_ns(void) {
+#ifdef HAVE_TSC
+    if (clk.tsc) {
+        unsigned aux;
+        uint64_t d = __rdtscp(&aux) - clk.tsc0;
+        return clk.ns0 + (uint64_t)(((unsigned __int128)d * clk.mult) >> 32);
+    }
+#endif
+    return raw_ns();
+}
+
+#ifdef HAVE_TSC
+static int tsc_invariant(void) {
+    unsigned a, b, c, d;
+    if (!__get_cpuid(0x80000000, &a, &b, &c, &d) || a < 0x80000007) return 0;
+    __get_cpuid(0x80000007, &a, &b, &c, &d);
+    if (!(d & (1u << 8))) return 0;                       /* invariant TSC */
+    __get_cpuid(0x80000001, &a, &b, &c, &d);
+    return (d & (1u << 27)) != 0;                         /* rdtscp */
+}
+
+/* Ticks per ns over a `ms` window, bracketing each TSC read tightly */
+static double tsc_rate(int ms) {
+    unsigned aux;
+    uint64_t n0 = raw_ns(), t0 = __rdtscp(&aux);
+    usleep((useconds_t)ms * 1000);
+    uint64_t n1 = raw_ns(), t1 = __rdtscp(&aux);
+    return (double)(t1 - t0) / (double)(n1 - n0);
+}
+#endif
+
+/* mode: "auto", "tsc" or "raw"; returns a description of the chosen clock */
+static const char *clock_init(const char *mode) {
+    static char desc[64];
+    clk.tsc = 0;
+    if (strcmp(mode, "raw") == 0) return "CLOCK_MONOTONIC_RAW";
+#ifdef HAVE_TSC
+    if (!tsc_invariant()) {
+        if (strcmp(mode, "tsc") == 0)
+            fprintf(stderr, "No invariant TSC with rdtscp, using CLOCK_MONOTONIC_RAW\n");
+        return "CLOCK_MONOTONIC_RAW (no invariant TSC)";
+    }
+    double r1 = tsc_rate(10), r2 = tsc_rate(20);
+    if (fabs(r1 - r2) / r2 > 500e-6) {
+        snprintf(desc, sizeof(desc), "CLOCK_MONOTONIC_RAW (TSC unstable, %.0f ppm)",
+                 fabs(r1 - r2) / r2 * 1e6);
+        return desc;
+    }
+    unsigned aux;
+    clk.ghz  = r2;
+    clk.mult = (uint64_t)(4294967296.0 / r2);
+    clk.ns0  = raw_ns();
+    clk.tsc0 = __rdtscp(&aux);
+    clk.tsc  = 1;
+    snprintf(desc, sizeof(desc), "TSC %.3f GHz (rdtscp)", clk.ghz);
+    return desc;
+#else
+    if (strcmp(mode, "tsc") == 0)
+        fprintf(stderr, "No TSC on this architecture, using CLOCK_MONOTONIC_RAW\n");
+    return "CLOCK_MONOTONIC_RAW";
+#endif
+}
+
 /* Get current time in seconds as double */
 static double get_time_sec(void) {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return ts.tv_sec + ts.tv_nsec / 1e9;
+    return get_time_ns() / 1e9;
 }
 
 /* Print progress bar in MB */
@@ -92,164 +358,5721 @@ static void print_progress(const char *op, size_t done, size_t total) {
     fflush(stdout);
 }
 
-int main(int argc, char *argv[]) {
-    if (argc != 5) {
-        fprintf(stderr,
-            "Usage: %s <filename> <size> <read|write|readwrite> <hex_pattern>\n"
-            "  filename    : target file path\n"
-            "  size        : number of bytes (e.g. 4096)\n"
-            "  mode        : read | write | readwrite\n"
-            "  hex_pattern : hex value e.g. 0xDEADBEEF\n",
-            argv[0]);
-        return EXIT_FAILURE;
+
+/*
+ * Sleep until the get_time_ns() deadline, spinning for the last few us. The
+ * sleep is relative because get_time_ns() need not be CLOCK_MONOTONIC.
+ */
+static void sleep_until_ns(uint64_t deadline) {
+    for (;;) {
+        uint64_t now = get_time_ns();
+        if (now >= deadline) return;
+        if (deadline - now > 50000) {
+            uint64_t        rel = deadline - now - 20000;
+            struct timespec ts  = { (time_t)(rel / 1000000000ull), (long)(rel % 1000000000ull) };
+            clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL);
+        }
+    }
+}
+
+/* Parse a size like "4096", "4k", "64K", "1m", "2G" into bytes */
+static size_t parse_size(const char *str) {
+    char *endptr;
+    unsigned long long value = strtoull(str, &endptr, 10);
+    switch (*endptr) {
+    case 'k': case 'K': value <<= 10; endptr++; break;
+    case 'm': case 'M': value <<= 20; endptr++; break;
+    case 'g': case 'G': value <<= 30; endptr++; break;
+    default: break;
+    }
+    if (endptr == str || *endptr != '\0') {
+        fprintf(stderr, "Invalid size: %s\n", str);
+        exit(EXIT_FAILURE);
+    }
+    return (size_t)value;
+}
+
+/* Parse a comma separated list of sizes ("4k,64k") into out[], return count */
+static int parse_size_list(const char *str, size_t *out, int max) {
+    char *copy = strdup(str);
+    int   n    = 0;
+    for (char *tok = strtok(copy, ","); tok; tok = strtok(NULL, ",")) {
+        if (n == max) {
+            fprintf(stderr, "Too many list entries (max %d): %s\n", max, str);
+            exit(EXIT_FAILURE);
+        }
+        out[n++] = parse_size(tok);
     }
+    free(copy);
+    return n;
+}
 
-    const char *filename  = argv[1];
-    size_t       size     = (size_t)strtoull(argv[2], NULL, 10);
-    const char  *mode     = argv[3];
-    uint64_t     hex_val  = parse_hex(argv[4]);
+/* ------------------------------------------------------------------ */
+/* Statistics                                                          */
+/* ------------------------------------------------------------------ */
 
-    /* Ensure size is a multiple of ALIGNMENT for O_DIRECT */
-    if (size % ALIGNMENT != 0) {
-        fprintf(stderr, "Size must be a multiple of %d for O_DIRECT\n", ALIGNMENT);
-        return EXIT_FAILURE;
+/*
+ * Every worker owns one cache-line aligned Stats slot and is its only writer.
+ * Updates are relaxed load+store pairs (plain moves on x86, no locked
+ * instructions), so the I/O path never takes a lock or bounces a shared line,
+ * while the monitor thread can snapshot slots at any time without tearing
+ * individual fields. Slots are merged at interval boundaries and at the end
+ * of a job.
+ */
+#define CACHE_LINE    64
+
+#define STAT_ADD(field, v) __atomic_store_n(&(field), (field) + (v), __ATOMIC_RELAXED)
+#define STAT_SET(field, v) __atomic_store_n(&(field), (v), __ATOMIC_RELAXED)
+#define STAT_GET(field)    __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+/*
+ * Log-linear histogram of nanosecond latencies: values below 2^HIST_SUB_BITS
+ * get their own bucket, above that each power of two is split into
+ * 2^HIST_SUB_BITS linear sub-buckets (~6% relative error).
+ */
+#define HIST_SUB_BITS 4
+#define HIST_SUB      (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS  (64 * HIST_SUB)
+
+typedef struct {
+    uint64_t bucket[HIST_BUCKETS];
+    uint64_t count;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    double   sum_ns;
+    double   sumsq_ns;
+} LatHist;
+
+typedef struct {
+    uint64_t ops;
+    uint64_t bytes;
+    uint64_t late;        /* open-loop: I/Os issued more than one slot behind schedule */
+    uint64_t max_lag_ns;  /* open-loop: worst submit delay behind schedule */
+    LatHist  lat;
+} Stats;
+
+static void hist_init(LatHist *h) {
+    memset(h, 0, sizeof(*h));
+    h->min_ns = UINT64_MAX;
+}
+
+static void stats_init(Stats *s) {
+    memset(s, 0, sizeof(*s));
+    hist_init(&s->lat);
+}
+
+static int hist_index(uint64_t v) {
+    if (v < HIST_SUB) return (int)v;
+    int msb   = 63 - __builtin_clzll(v);
+    int shift = msb - HIST_SUB_BITS;
+    return (shift + 1) * HIST_SUB + (int)((v >> shift) & (HIST_SUB - 1));
+}
+
+/* Midpoint of bucket idx in nanoseconds */
+static uint64_t hist_value(int idx) {
+    if (idx < HIST_SUB) return (uint64_t)idx;
+    int      shift = idx / HIST_SUB - 1;
+    uint64_t sub   = (uint64_t)(idx % HIST_SUB);
+    return ((HIST_SUB + sub) << shift) + ((1ull << shift) >> 1);
+}
+
+/* Single-writer add, safe against a concurrent stats_snapshot() */
+static void hist_add(LatHist *h, uint64_t ns) {
+    double sum   = h->sum_ns + (double)ns;
+    double sumsq = h->sumsq_ns + (double)ns * (double)ns;
+    STAT_ADD(h->bucket[hist_index(ns)], 1);
+    STAT_ADD(h->count, 1);
+    if (ns < h->min_ns) STAT_SET(h->min_ns, ns);
+    if (ns > h->max_ns) STAT_SET(h->max_ns, ns);
+    __atomic_store(&h->sum_ns, &sum, __ATOMIC_RELAXED);
+    __atomic_store(&h->sumsq_ns, &sumsq, __ATOMIC_RELAXED);
+}
+
+static void hist_merge(LatHist *dst, const LatHist *src) {
+    for (int i = 0; i < HIST_BUCKETS; i++)
+        dst->bucket[i] += src->bucket[i];
+    dst->count    += src->count;
+    dst->sum_ns   += src->sum_ns;
+    dst->sumsq_ns += src->sumsq_ns;
+    if (src->min_ns < dst->min_ns) dst->min_ns = src->min_ns;
+    if (src->max_ns > dst->max_ns) dst->max_ns = src->max_ns;
+}
+
+/* Latency at percentile p (0..100) in nanoseconds */
+static uint64_t hist_percentile(const LatHist *h, double p) {
+    if (h->count == 0) return 0;
+    uint64_t target = (uint64_t)ceil(p / 100.0 * (double)h->count);
+    if (target == 0) target = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->bucket[i];
+        if (seen >= target) {
+            uint64_t v = hist_value(i);
+            if (v > h->max_ns) v = h->max_ns;
+            if (v < h->min_ns) v = h->min_ns;
+            return v;
+        }
     }
+    return h->max_ns;
+}
 
-    /* Build the packed HexPattern from parsed hex value */
-    HexPattern pat;
-    pat.pattern8  = (uint8_t) (hex_val & 0xFF);
-    pat.pattern16 = (uint16_t)(hex_val & 0xFFFF);
-    pat.pattern32 = (uint32_t)(hex_val & 0xFFFFFFFF);
-    pat.pattern64 = hex_val;
+static double hist_mean(const LatHist *h) {
+    return h->count ? h->sum_ns / (double)h->count : 0.0;
+}
 
-    printf("=== Direct I/O Pattern Test ===\n");
-    printf("File    : %s\n", filename);
-    printf("Size    : %zu bytes (%.2f MB)\n", size, (double)size / MB);
-    printf("Mode    : %s\n", mode);
-    printf("Pattern : 0x%llX\n", (unsigned long long)hex_val);
-    printf("Pattern structure (packed, %zu bytes):\n", sizeof(HexPattern));
-    printf("  pattern8  = 0x%02X\n", pat.pattern8);
-    printf("  pattern16 = 0x%04X\n", pat.pattern16);
-    printf("  pattern32 = 0x%08X\n", pat.pattern32);
-    printf("  pattern64 = 0x%016llX\n", (unsigned long long)pat.pattern64);
-    printf("Buffer  : %d MB (reusable chunk)\n\n", CHUNK_SIZE / MB);
+static double hist_stddev(const LatHist *h) {
+    if (h->count < 2) return 0.0;
+    double mean = hist_mean(h);
+    double var  = h->sumsq_ns / (double)h->count - mean * mean;
+    return var > 0 ? sqrt(var) : 0.0;
+}
 
-    /* Allocate a single reusable aligned chunk buffer */
-    uint8_t *chunk_buf = NULL;
-    if (posix_memalign((void **)&chunk_buf, ALIGNMENT, CHUNK_SIZE) != 0) {
-        perror("posix_memalign");
-        return EXIT_FAILURE;
+/* Lock-free copy of a slot that its worker may still be updating */
+static void stats_snapshot(Stats *dst, const Stats *src) {
+    dst->ops        = STAT_GET(src->ops);
+    dst->bytes      = STAT_GET(src->bytes);
+    dst->late       = STAT_GET(src->late);
+    dst->max_lag_ns = STAT_GET(src->max_lag_ns);
+    for (int i = 0; i < HIST_BUCKETS; i++)
+        dst->lat.bucket[i] = STAT_GET(src->lat.bucket[i]);
+    dst->lat.count  = STAT_GET(src->lat.count);
+    dst->lat.min_ns = STAT_GET(src->lat.min_ns);
+    dst->lat.max_ns = STAT_GET(src->lat.max_ns);
+    __atomic_load(&src->lat.sum_ns, &dst->lat.sum_ns, __ATOMIC_RELAXED);
+    __atomic_load(&src->lat.sumsq_ns, &dst->lat.sumsq_ns, __ATOMIC_RELAXED);
+}
+
+static void stats_merge(Stats *dst, const Stats *src) {
+    dst->ops   += src->ops;
+    dst->bytes += src->bytes;
+    dst->late  += src->late;
+    if (src->max_lag_ns > dst->max_lag_ns) dst->max_lag_ns = src->max_lag_ns;
+    hist_merge(&dst->lat, &src->lat);
+}
+
+/* out = cur - prev; min/max are recovered from the interval's buckets */
+static void stats_delta(Stats *out, const Stats *cur, const Stats *prev) {
+    stats_init(out);
+    out->ops        = cur->ops - prev->ops;
+    out->bytes      = cur->bytes - prev->bytes;
+    out->late       = cur->late - prev->late;
+    out->max_lag_ns = cur->max_lag_ns;
+    out->lat.count    = cur->lat.count - prev->lat.count;
+    out->lat.sum_ns   = cur->lat.sum_ns - prev->lat.sum_ns;
+    out->lat.sumsq_ns = cur->lat.sumsq_ns - prev->lat.sumsq_ns;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        uint64_t n = cur->lat.bucket[i] - prev->lat.bucket[i];
+        out->lat.bucket[i] = n;
+        if (n == 0) continue;
+        if (out->lat.min_ns == UINT64_MAX) out->lat.min_ns = hist_value(i);
+        out->lat.max_ns = hist_value(i);
     }
+}
 
-    /* Pre-fill the chunk buffer once with the pattern */
-    fill_buffer(chunk_buf, CHUNK_SIZE, &pat);
-    dump_hex(chunk_buf, CHUNK_SIZE, "Pattern buffer");
+/* ------------------------------------------------------------------ */
+/* Options                                                             */
+/* ------------------------------------------------------------------ */
 
-    /* ---- WRITE ---- */
-    if (strcmp(mode, "write") == 0 || strcmp(mode, "readwrite") == 0) {
-        int fd = open(filename, O_WRONLY | O_CREAT | O_DIRECT | O_TRUNC, 0644);
-        if (fd < 0) {
-            perror("open (write)");
-            free(chunk_buf);
-            return EXIT_FAILURE;
+/* RW_COPY is internal to copy mode and cannot be selected with --rw */
+typedef enum { RW_READ, RW_WRITE, RW_RANDREAD, RW_RANDWRITE, RW_COPY } RwType;
+
+#define RW_USER_TYPES 4
+
+static const char *rw_names[] = { "read", "write", "randread", "randwrite", "copy" };
+
+static int rw_is_write(RwType rw)  { return rw == RW_WRITE || rw == RW_RANDWRITE; }
+static int rw_is_random(RwType rw) { return rw == RW_RANDREAD || rw == RW_RANDWRITE; }
+
+/* --link: what the per-core engine chains behind each write */
+typedef enum { LINK_NONE, LINK_FSYNC, LINK_FDATASYNC, LINK_READ } LinkKind;
+
+static const char *link_names[] = { "none", "fsync", "fdatasync", "read" };
+
+/* --cache: how the classic engine reaches the file */
+typedef enum { CACHE_DIRECT, CACHE_BUFFERED, CACHE_DONTCACHE } CacheMode;
+
+static const char *cache_names[] = { "direct", "buffered", "dontcache" };
+
+typedef enum { FMT_TEXT, FMT_CSV, FMT_JSON } ReportFormat;
+
+static const char *format_names[] = { "text", "csv", "json" };
+
+/* ------------------------------------------------------------------ */
+/* Performance thresholds                                              */
+/* ------------------------------------------------------------------ */
+
+/* --min-* / --max-* gates; 0 = not checked. Latencies in microseconds. */
+typedef struct {
+    double min_mbps;
+    double min_iops;
+    double max_p99;
+    double max_p999;
+    double max_stddev;
+} Slo;
+
+static int slo_active(const Slo *s) {
+    return s->min_mbps > 0 || s->min_iops > 0 || s->max_p99 > 0 || s->max_p999 > 0 ||
+           s->max_stddev > 0;
+}
+
+/* Returns the number of thresholds missed and describes them in why */
+static int slo_check(const Slo *s, double iops, double mbps, double p99, double p999,
+                     double stddev, char *why, size_t len) {
+    int n = 0;
+    why[0] = '\0';
+#define SLO_MISS(cond, ...) \
+    if (cond) { size_t u = strlen(why); snprintf(why + u, len - u, "%s", n++ ? ", " : ""); \
+                u = strlen(why); snprintf(why + u, len - u, __VA_ARGS__); }
+    SLO_MISS(s->min_mbps > 0 && mbps < s->min_mbps, "%.2f MB/s < %g MB/s", mbps, s->min_mbps)
+    SLO_MISS(s->min_iops > 0 && iops < s->min_iops, "%.0f IOPS < %g IOPS", iops, s->min_iops)
+    SLO_MISS(s->max_p99 > 0 && p99 > s->max_p99, "p99 %.1f us > %g us", p99, s->max_p99)
+    SLO_MISS(s->max_p999 > 0 && p999 > s->max_p999, "p99.9 %.1f us > %g us", p999, s->max_p999)
+    SLO_MISS(s->max_stddev > 0 && stddev > s->max_stddev, "stddev %.1f us > %g us",
+             stddev, s->max_stddev)
+#undef SLO_MISS
+    return n;
+}
+
+typedef struct {
+    RwType        rw;
+    size_t        bs_list[MAX_SWEEP];
+    int           nbs;
+    int           bs_set;
+    size_t        qd_list[MAX_SWEEP];
+    int           nqd;
+    int           qd_set;
+    double        runtime;
+    int           runtime_set;
+    double        rate;
+    double        interval;
+    const char   *dest;
+    int           passes;
+    int           on_error_continue;
+    int           retries;
+    int           retry_delay_ms;
+    size_t        isolate_bs;
+    const char   *badblocks_out;
+    const char   *skip_list;
+    const char   *bitmap;
+    int           device_stats;
+    double        slow_us;
+    int           slow_ring;
+    const char   *slow_out;
+    const char   *trace;
+    const char   *clock;
+    int           regions;
+    const char   *heatmap;
+    double        classes_ms[MAX_CLASSES];
+    int           nclasses;
+    int           precondition;
+    int           rounds;
+    int           ss_window;
+    Slo           slo;
+    int           repeat;
+    double        target_p99;
+    size_t        cores_list[MAX_SWEEP];
+    int           ncores;
+    size_t        steal_unit;
+    LinkKind      link;
+    int           buf_ring;
+    CacheMode     cache;
+    int           drop_caches;
+    double        cooldown;
+    PatternKind   patterns[MAX_SWEEP];
+    int           npatterns;
+    ReportFormat  format;
+    int           format_set;
+    const char   *output;
+} Options;
+
+/* ------------------------------------------------------------------ */
+/* Error map                                                           */
+/* ------------------------------------------------------------------ */
+
+/*
+ * With --on-error=continue a failed I/O no longer ends the run: it is
+ * retried, then split in halves down to isolate_bs so that only the
+ * sectors which really fail get recorded here. Later phases skip the
+ * recorded ranges. Verify also records the sectors holding mismatched
+ * data (err 0); those are reported but not skipped, so a later pass still
+ * checks them. Errors are rare, so a mutex is fine; `count` lets the hot
+ * path skip the lock while the map is empty.
+ */
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    RwType   rw;
+    int      err;     /* errno of the last failed attempt, 0 = data mismatch */
+} ErrRange;
+
+typedef struct {
+    int                  recover;     /* --on-error=continue */
+    int                  retries;     /* extra attempts before isolating */
+    int                  delay_ms;    /* pause before each retry */
+    size_t               isolate_bs;  /* smallest range that is retried on its own */
+    pthread_mutex_t      lock;
+    ErrRange            *ranges;      /* sorted by start, non-overlapping per rw/err */
+    int                  nranges;
+    int                  cap;
+    atomic_int           count;
+    atomic_uint_fast64_t retried;
+    atomic_uint_fast64_t recovered;
+} ErrorMap;
+
+static void errmap_init(ErrorMap *m, int recover, int retries, int delay_ms, size_t isolate_bs) {
+    memset(m, 0, sizeof(*m));
+    m->recover    = recover;
+    m->retries    = retries;
+    m->delay_ms   = delay_ms;
+    m->isolate_bs = isolate_bs;
+    pthread_mutex_init(&m->lock, NULL);
+    atomic_init(&m->count, 0);
+    atomic_init(&m->retried, 0);
+    atomic_init(&m->recovered, 0);
+}
+
+static void errmap_free(ErrorMap *m) {
+    pthread_mutex_destroy(&m->lock);
+    free(m->ranges);
+}
+
+/* Record [start, end) as failed, merging with an adjacent range of the same kind */
+static void errmap_add(ErrorMap *m, uint64_t start, uint64_t end, RwType rw, int err) {
+    pthread_mutex_lock(&m->lock);
+    int i = 0;
+    while (i < m->nranges && m->ranges[i].start < start) i++;
+
+    ErrRange *prev = i > 0 ? &m->ranges[i - 1] : NULL;
+    if (prev && prev->end >= start && prev->rw == rw && prev->err == err) {
+        if (end > prev->end) prev->end = end;
+    } else {
+        if (m->nranges == m->cap) {
+            m->cap    = m->cap ? m->cap * 2 : 16;
+            m->ranges = realloc(m->ranges, (size_t)m->cap * sizeof(ErrRange));
+            if (!m->ranges) {
+                perror("realloc (error map)");
+                exit(EXIT_FAILURE);
+            }
+        }
+        memmove(&m->ranges[i + 1], &m->ranges[i], (size_t)(m->nranges - i) * sizeof(ErrRange));
+        m->ranges[i] = (ErrRange){ start, end, rw, err };
+        m->nranges++;
+        prev = &m->ranges[i];
+    }
+    /* Absorb following ranges now covered by prev */
+    while (i + 1 < m->nranges && m->ranges[i + 1].start <= prev->end &&
+           m->ranges[i + 1].rw == rw && m->ranges[i + 1].err == err) {
+        if (m->ranges[i + 1].end > prev->end) prev->end = m->ranges[i + 1].end;
+        memmove(&m->ranges[i + 1], &m->ranges[i + 2],
+                (size_t)(m->nranges - i - 2) * sizeof(ErrRange));
+        m->nranges--;
+    }
+    atomic_store(&m->count, m->nranges);
+    pthread_mutex_unlock(&m->lock);
+}
+
+/* First failed-I/O range overlapping [start, end); returns 0 if there is none */
+static int errmap_next(ErrorMap *m, uint64_t start, uint64_t end, uint64_t *s, uint64_t *e) {
+    if (atomic_load_explicit(&m->count, memory_order_relaxed) == 0) return 0;
+    int found = 0;
+    pthread_mutex_lock(&m->lock);
+    for (int i = 0; i < m->nranges; i++) {
+        if (m->ranges[i].end <= start || m->ranges[i].err == 0) continue;
+        if (m->ranges[i].start >= end) break;
+        if (!found || m->ranges[i].start < *s) {
+            *s = m->ranges[i].start;
+            *e = m->ranges[i].end;
         }
+        found = 1;
+    }
+    pthread_mutex_unlock(&m->lock);
+    return found;
+}
 
-        size_t  total_written = 0;
-        double  t_start       = get_time_sec();
+static uint64_t errmap_bytes(const ErrorMap *m) {
+    uint64_t total = 0;
+    for (int i = 0; i < m->nranges; i++) total += m->ranges[i].end - m->ranges[i].start;
+    return total;
+}
 
-        while (total_written < size) {
-            /* Use remaining size if less than CHUNK_SIZE */
-            size_t  chunk    = (size - total_written) < (size_t)CHUNK_SIZE
-                               ? (size - total_written) : (size_t)CHUNK_SIZE;
-            ssize_t written  = pwrite(fd, chunk_buf, chunk, (off_t)total_written);
-            if (written < 0) {
-                perror("\npwrite");
-                close(fd); free(chunk_buf);
-                return EXIT_FAILURE;
+/* Number of ranges that are I/O failures rather than data mismatches */
+static int errmap_io_ranges(const ErrorMap *m) {
+    int n = 0;
+    for (int i = 0; i < m->nranges; i++) n += m->ranges[i].err != 0;
+    return n;
+}
+
+static const char *errmap_reason(int err) {
+    return err ? strerror(err) : "data mismatch";
+}
+
+/* ------------------------------------------------------------------ */
+/* Skip list                                                           */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Known-bad ranges loaded with --skip, kept as a static interval tree: the
+ * ranges are sorted by start and viewed as an implicit balanced BST (root of
+ * [lo, hi) is the middle element) where every node also stores the largest
+ * end in its subtree. The tree is read-only once built, so workers query it
+ * without locks; a lookup costs O(log n) and prunes any subtree that ends
+ * before the queried block.
+ */
+typedef struct {
+    uint64_t *start;
+    uint64_t *end;
+    uint64_t *max_end;
+    int       n;
+    size_t    sector;      /* sector size the file was written with */
+} SkipTree;
+
+static int cmp_range(const void *a, const void *b) {
+    const uint64_t *x = a, *y = b;
+    return x[0] < y[0] ? -1 : x[0] > y[0] ? 1 : 0;
+}
+
+static uint64_t skiptree_build(SkipTree *t, int lo, int hi) {
+    if (lo >= hi) return 0;
+    int      mid = lo + (hi - lo) / 2;
+    uint64_t m   = t->end[mid];
+    uint64_t l   = skiptree_build(t, lo, mid);
+    uint64_t r   = skiptree_build(t, mid + 1, hi);
+    if (l > m) m = l;
+    if (r > m) m = r;
+    t->max_end[mid] = m;
+    return m;
+}
+
+/* Index of the lowest-starting range overlapping [a, b) in [lo, hi), or -1 */
+static int skiptree_find(const SkipTree *t, int lo, int hi, uint64_t a, uint64_t b) {
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (t->max_end[mid] <= a) return -1;
+        int left = skiptree_find(t, lo, mid, a, b);
+        if (left >= 0) return left;
+        if (t->start[mid] >= b) return -1;
+        if (t->end[mid] > a) return mid;
+        lo = mid + 1;
+    }
+    return -1;
+}
+
+static int skiptree_next(const SkipTree *t, uint64_t a, uint64_t b, uint64_t *s, uint64_t *e) {
+    if (!t || t->n == 0) return 0;
+    int i = skiptree_find(t, 0, t->n, a, b);
+    if (i < 0) return 0;
+    *s = t->start[i];
+    *e = t->end[i];
+    return 1;
+}
+
+static void skiptree_free(SkipTree *t) {
+    free(t->start);
+    free(t->end);
+    free(t->max_end);
+}
+
+/*
+ * Read a range file written by --badblocks-out: "first_lba count [reason]"
+ * per line, '#' comments, "# sector_size N" selects the LBA size (512 if
+ * absent).
+ */
+static int skiptree_load(SkipTree *t, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror("fopen (skip list)");
+        return -1;
+    }
+    memset(t, 0, sizeof(*t));
+    t->sector = ALIGNMENT;
+
+    uint64_t (*pairs)[2] = NULL;
+    int       cap = 0;
+    char      line[256];
+    int       lineno = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        unsigned long long a, b;
+        if (line[0] == '#') {
+            if (sscanf(line, "# sector_size %llu", &a) == 1 && a > 0) t->sector = (size_t)a;
+            continue;
+        }
+        if (strspn(line, " \t\r\n") == strlen(line)) continue;
+        if (sscanf(line, "%llu %llu", &a, &b) != 2 || b == 0) {
+            fprintf(stderr, "%s:%d: expected \"first_lba count\"\n", path, lineno);
+            free(pairs);
+            fclose(f);
+            return -1;
+        }
+        if (t->n == cap) {
+            int ncap = cap ? cap * 2 : 64;
+            uint64_t (*np)[2] = realloc(pairs, (size_t)ncap * sizeof(*pairs));
+            if (!np) {
+                perror("realloc (skip list)");
+                free(pairs);
+                fclose(f);
+                return -1;
             }
-            total_written += (size_t)written;
-            print_progress("WRITE", total_written, size);
+            pairs = np;
+            cap   = ncap;
         }
+        pairs[t->n][0] = (uint64_t)a;
+        pairs[t->n][1] = (uint64_t)a + b;
+        t->n++;
+    }
+    fclose(f);
+    if (t->n == 0) return 0;   /* empty list: lookups stop at t->n */
 
-        double t_elapsed  = get_time_sec() - t_start;
-        double throughput = ((double)total_written / MB) / t_elapsed;
-        printf("\n[WRITE] Written %.2f MB in %.3f sec => %.2f MB/s\n",
-               (double)total_written / MB, t_elapsed, throughput);
-        close(fd);
+    qsort(pairs, (size_t)t->n, sizeof(*pairs), cmp_range);
+    t->start   = malloc((size_t)t->n * sizeof(uint64_t));
+    t->end     = malloc((size_t)t->n * sizeof(uint64_t));
+    t->max_end = malloc((size_t)t->n * sizeof(uint64_t));
+    if (!t->start || !t->end || !t->max_end) {
+        perror("malloc (skip list)");
+        free(pairs);
+        skiptree_free(t);
+        memset(t, 0, sizeof(*t));
+        return -1;
+    }
+    for (int i = 0; i < t->n; i++) {
+        t->start[i] = pairs[i][0] * t->sector;
+        t->end[i]   = pairs[i][1] * t->sector;
     }
+    free(pairs);
+    skiptree_build(t, 0, t->n);
+    return 0;
+}
+
+static uint64_t skiptree_bytes(const SkipTree *t) {
+    uint64_t total = 0;
+    for (int i = 0; i < t->n; i++) total += t->end[i] - t->start[i];
+    return total;
+}
 
-    /* ---- READ + VERIFY ---- */
-    if (strcmp(mode, "read") == 0 || strcmp(mode, "readwrite") == 0) {
+/* ------------------------------------------------------------------ */
+/* Written-block map                                                   */
+/* ------------------------------------------------------------------ */
 
-        /* Allocate a separate read chunk - same size as write chunk */
-        uint8_t *read_buf = NULL;
-        if (posix_memalign((void **)&read_buf, ALIGNMENT, CHUNK_SIZE) != 0) {
-            perror("posix_memalign (read)");
-            free(chunk_buf);
-            return EXIT_FAILURE;
+/*
+ * Random and time-based writes leave some blocks of [0, size) untouched, so
+ * the verify pass must only check blocks that were written. One bit per
+ * block, set by the writer with an atomic OR; `gen` counts the write runs
+ * that contributed. The map is persisted run-length encoded (--bitmap) so a
+ * later verify-only run, or another random write run, can pick it up.
+ */
+typedef struct {
+    atomic_uint_fast64_t *words;
+    uint64_t              nblocks;
+    size_t                bs;
+    size_t                size;
+    uint64_t              gen;      /* write runs recorded in this map */
+    uint64_t              pattern;  /* hex pattern the blocks were written with */
+} BlockMap;
+
+#define BLOCKMAP_MAGIC "SNBBMAP1"
+
+static void blockmap_init(BlockMap *m, size_t size, size_t bs, uint64_t pattern) {
+    m->nblocks = (size + bs - 1) / bs;
+    m->bs      = bs;
+    m->size    = size;
+    m->gen     = 0;
+    m->pattern = pattern;
+    m->words   = calloc((size_t)(m->nblocks + 63) / 64 + 1, sizeof(*m->words));
+    if (!m->words) {
+        perror("calloc (block map)");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void blockmap_set(BlockMap *m, uint64_t blk) {
+    atomic_fetch_or_explicit(&m->words[blk / 64], 1ull << (blk % 64), memory_order_relaxed);
+}
+
+static int blockmap_test(const BlockMap *m, uint64_t blk) {
+    return (atomic_load_explicit(&m->words[blk / 64], memory_order_relaxed) >> (blk % 64)) & 1;
+}
+
+static uint64_t blockmap_count(const BlockMap *m) {
+    uint64_t n = 0;
+    for (uint64_t i = 0; i < (m->nblocks + 63) / 64; i++)
+        n += (uint64_t)__builtin_popcountll(atomic_load(&m->words[i]));
+    return n;
+}
+
+/*
+ * File layout (host byte order): magic, then size, bs, nblocks, gen, pattern
+ * and nruns as uint64, then nruns run lengths alternating between unwritten
+ * and written blocks, starting with unwritten.
+ */
+static int blockmap_save(const BlockMap *m, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror("fopen (bitmap)");
+        return -1;
+    }
+    uint64_t nruns = 0, run = 0;
+    int      cur = 0;
+    for (uint64_t b = 0; b < m->nblocks; b++) {
+        if (blockmap_test(m, b) != cur) {
+            nruns++;
+            cur = !cur;
         }
+    }
+    nruns++;
+    uint64_t hdr[6] = { m->size, m->bs, m->nblocks, m->gen, m->pattern, nruns };
+    int      ok     = fwrite(BLOCKMAP_MAGIC, 8, 1, f) == 1 && fwrite(hdr, sizeof(hdr), 1, f) == 1;
 
-        int fd = open(filename, O_RDONLY | O_DIRECT);
-        if (fd < 0) {
-            perror("open (read)");
-            free(chunk_buf); free(read_buf);
-            return EXIT_FAILURE;
+    cur = 0;
+    for (uint64_t b = 0; ok && b < m->nblocks; b++) {
+        if (blockmap_test(m, b) != cur) {
+            ok  = fwrite(&run, sizeof(run), 1, f) == 1;
+            run = 0;
+            cur = !cur;
         }
+        run++;
+    }
+    if (ok) ok = fwrite(&run, sizeof(run), 1, f) == 1;
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) {
+        perror("write (bitmap)");
+        return -1;
+    }
+    return 0;
+}
 
-        size_t  total_read = 0;
-        int     mismatch   = 0;
-        double  t_start    = get_time_sec();
+static int blockmap_load(BlockMap *m, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    char     magic[8];
+    uint64_t hdr[6];
+    if (fread(magic, 8, 1, f) != 1 || memcmp(magic, BLOCKMAP_MAGIC, 8) != 0 ||
+        fread(hdr, sizeof(hdr), 1, f) != 1 || hdr[1] == 0 ||
+        hdr[2] != (hdr[0] + hdr[1] - 1) / hdr[1]) {
+        fprintf(stderr, "%s: not a block map\n", path);
+        fclose(f);
+        return -1;
+    }
+    blockmap_init(m, (size_t)hdr[0], (size_t)hdr[1], hdr[4]);
+    m->gen = hdr[3];
 
-        while (total_read < size) {
-            size_t  chunk      = (size - total_read) < (size_t)CHUNK_SIZE
-                                 ? (size - total_read) : (size_t)CHUNK_SIZE;
-            ssize_t bytes_read = pread(fd, read_buf, chunk, (off_t)total_read);
-            if (bytes_read < 0) {
-                perror("\npread");
-                close(fd); free(chunk_buf); free(read_buf);
-                return EXIT_FAILURE;
-            }
-            if (bytes_read == 0) break; /* EOF */
-
-            total_read += (size_t)bytes_read;
-            print_progress("READ ", total_read, size);
-
-            /* Verify this chunk inline against re-filled pattern chunk */
-            fill_buffer(chunk_buf, (size_t)bytes_read, &pat);
-            for (ssize_t i = 0; i < bytes_read; i++) {
-                if (chunk_buf[i] != read_buf[i]) {
-                    fprintf(stderr,
-                        "\n  MISMATCH at offset %zu (%.2f MB): "
-                        "expected 0x%02X got 0x%02X\n",
-                        (total_read - (size_t)bytes_read) + (size_t)i,
-                        (double)((total_read - (size_t)bytes_read) + (size_t)i) / MB,
-                        chunk_buf[i], read_buf[i]);
-                    mismatch++;
-                    if (mismatch >= 10) {
-                        fprintf(stderr, "  ... (too many mismatches, stopping)\n");
-                        goto verify_done;
-                    }
-                }
-            }
+    uint64_t b = 0, run;
+    for (uint64_t i = 0; i < hdr[5]; i++) {
+        if (fread(&run, sizeof(run), 1, f) != 1 || run > m->nblocks - b) {
+            fprintf(stderr, "%s: truncated or corrupt block map\n", path);
+            free(m->words);
+            fclose(f);
+            return -1;
         }
+        if (i & 1)
+            for (uint64_t k = b; k < b + run; k++) blockmap_set(m, k);
+        b += run;
+    }
+    fclose(f);
+    return 0;
+}
 
-verify_done:
-        ;
-        double t_elapsed  = get_time_sec() - t_start;
-        double throughput = ((double)total_read / MB) / t_elapsed;
-        printf("\n[READ]  Read %.2f MB in %.3f sec => %.2f MB/s\n",
-               (double)total_read / MB, t_elapsed, throughput);
-
-        if (mismatch == 0)
-            printf("[VERIFY] PASSED - All %.2f MB match the pattern!\n",
-                   (double)total_read / MB);
-        else
-            printf("[VERIFY] FAILED - %d mismatch(es) found!\n", mismatch);
+/* ------------------------------------------------------------------ */
+/* Device counters                                                     */
+/* ------------------------------------------------------------------ */
 
-        close(fd);
-        free(read_buf);
+/*
+ * Endurance needs host writes next to what the device really wrote. The
+ * block layer count comes from /proc/diskstats for the device holding the
+ * target (the partition itself, or the filesystem's device for a regular
+ * file). NVMe disks also report "data units written" in the SMART log, and
+ * drives with the OCP C0 log report physical media (NAND) bytes written;
+ * both need CAP_SYS_ADMIN and are skipped silently when unavailable.
+ *
+ * The block layer fields also give the kernel's view of each interval
+ * (throughput, merges, average queue depth), which shows where the tool
+ * and iostat disagree because of merging, splitting or the page cache.
+ */
+typedef struct {
+    unsigned maj, min;
+    char     name[64];       /* kernel name of the block device */
+    char     nvme[80];       /* /dev node for admin commands, "" if not NVMe */
+    char     stat[64];       /* /sys/dev/block/M:m/stat */
+} Device;
+
+typedef struct {
+    int      valid;          /* diskstats read */
+    uint64_t reads;          /* completed requests */
+    uint64_t writes;
+    uint64_t read_merges;
+    uint64_t write_merges;
+    uint64_t in_flight;      /* instantaneous, not a counter */
+    uint64_t io_ticks;       /* ms the device had I/O in flight */
+    uint64_t time_in_queue;  /* ms, weighted by requests in flight */
+    uint64_t sectors_read;   /* 512-byte units */
+    uint64_t sectors_written;
+    int      smart;          /* NVMe SMART log read */
+    uint64_t data_units_written;  /* 1000 x 512 bytes */
+    int      media;          /* OCP C0 log read */
+    uint64_t media_written;  /* bytes */
+} DevCounters;
+
+#define NVME_LOG_SMART      0x02
+#define NVME_LOG_OCP_SMART  0xC0
+
+/* GUID closing the OCP C0 log page, as stored on the wire */
+static const uint8_t ocp_c0_guid[16] = {
+    0xC5, 0xAF, 0x10, 0x28, 0xEA, 0xBF, 0xF2, 0xA4,
+    0x9C, 0x4F, 0x6F, 0x7C, 0xC9, 0x14, 0xD5, 0xAF
+};
+
+static int device_open(Device *d, const char *filename) {
+    struct stat st;
+    if (stat(filename, &st) != 0) return -1;
+    dev_t dev = S_ISBLK(st.st_mode) ? st.st_rdev : st.st_dev;
+
+    memset(d, 0, sizeof(*d));
+    d->maj = major(dev);
+    d->min = minor(dev);
+
+    char    sys[48], link[PATH_MAX];
+    snprintf(sys, sizeof(sys), "/sys/dev/block/%u:%u", d->maj, d->min);
+    snprintf(d->stat, sizeof(d->stat), "%s/stat", sys);
+    ssize_t n = readlink(sys, link, sizeof(link) - 1);
+    if (n <= 0) return -1;
+    link[n] = '\0';
+    char *base = strrchr(link, '/');
+    snprintf(d->name, sizeof(d->name), "%.63s", base ? base + 1 : link);
+
+    /* A partition's parent directory is the whole disk */
+    char *disk = d->name;
+    char  part[96];
+    snprintf(part, sizeof(part), "%s/partition", sys);
+    if (access(part, F_OK) == 0 && base) {
+        *base = '\0';
+        char *parent = strrchr(link, '/');
+        disk = parent ? parent + 1 : link;
     }
+    if (strncmp(disk, "nvme", 4) == 0) snprintf(d->nvme, sizeof(d->nvme), "/dev/%.70s", disk);
+    return 0;
+}
 
-    free(chunk_buf);
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+static int nvme_get_log(int fd, uint8_t lid, void *buf, uint32_t len) {
+    struct nvme_admin_cmd cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.opcode   = 0x02;                       /* Get Log Page */
+    cmd.nsid     = 0xFFFFFFFF;
+    cmd.addr     = (uint64_t)(uintptr_t)buf;
+    cmd.data_len = len;
+    cmd.cdw10    = ((len / 4 - 1) << 16) | lid;
+    return ioctl(fd, NVME_IOCTL_ADMIN_CMD, &cmd) == 0 ? 0 : -1;
+}
+
+static uint64_t le64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = v << 8 | p[i];
+    return v;
+}
+
+/* The 11 classic fields shared by /sys/.../stat and /proc/diskstats */
+static int parse_diskstat(const char *s, DevCounters *c) {
+    unsigned long long v[11];
+    if (sscanf(s, "%llu %llu %llu %llu %llu %llu %llu %llu %llu %llu %llu",
+               &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9],
+               &v[10]) != 11)
+        return -1;
+    c->valid           = 1;
+    c->reads           = v[0];
+    c->read_merges     = v[1];
+    c->sectors_read    = v[2];
+    c->writes          = v[4];
+    c->write_merges    = v[5];
+    c->sectors_written = v[6];
+    c->in_flight       = v[8];
+    c->io_ticks        = v[9];
+    c->time_in_queue   = v[10];
+    return 0;
+}
+
+/* Block layer counters only: cheap enough for every interval */
+static void device_read_stat(const Device *d, DevCounters *c) {
+    char  line[512];
+    FILE *f = fopen(d->stat, "r");
+    if (f) {
+        int ok = fgets(line, sizeof(line), f) && parse_diskstat(line, c) == 0;
+        fclose(f);
+        if (ok) return;
+    }
+    /* No sysfs: fall back to the device's line in /proc/diskstats */
+    f = fopen("/proc/diskstats", "r");
+    if (!f) return;
+    while (fgets(line, sizeof(line), f)) {
+        unsigned maj, min;
+        int      off = 0;
+        if (sscanf(line, "%u %u %*s %n", &maj, &min, &off) >= 2 && off > 0 &&
+            maj == d->maj && min == d->min) {
+            parse_diskstat(line + off, c);
+            break;
+        }
+    }
+    fclose(f);
+}
+
+static void device_read(const Device *d, DevCounters *c) {
+    memset(c, 0, sizeof(*c));
+    device_read_stat(d, c);
+    if (!d->nvme[0]) return;
+
+    int fd = open(d->nvme, O_RDONLY);
+    if (fd < 0) return;
+    uint8_t log[512];
+    if (nvme_get_log(fd, NVME_LOG_SMART, log, sizeof(log)) == 0) {
+        c->smart              = 1;
+        c->data_units_written = le64(log + 48);
+    }
+    if (nvme_get_log(fd, NVME_LOG_OCP_SMART, log, sizeof(log)) == 0 &&
+        memcmp(log + 496, ocp_c0_guid, sizeof(ocp_c0_guid)) == 0) {
+        c->media         = 1;
+        c->media_written = le64(log);
+    }
+    close(fd);
+}
+
+/* after - before, keeping only the counters read both times */
+static void device_delta(DevCounters *out, const DevCounters *a, const DevCounters *b) {
+    memset(out, 0, sizeof(*out));
+    out->valid = a->valid && b->valid;
+    out->smart = a->smart && b->smart;
+    out->media = a->media && b->media;
+    if (out->valid) {
+        out->reads           = b->reads - a->reads;
+        out->writes          = b->writes - a->writes;
+        out->read_merges     = b->read_merges - a->read_merges;
+        out->write_merges    = b->write_merges - a->write_merges;
+        out->in_flight       = b->in_flight;
+        out->io_ticks        = b->io_ticks - a->io_ticks;
+        out->time_in_queue   = b->time_in_queue - a->time_in_queue;
+        out->sectors_read    = b->sectors_read - a->sectors_read;
+        out->sectors_written = b->sectors_written - a->sectors_written;
+    }
+    if (out->smart) out->data_units_written = b->data_units_written - a->data_units_written;
+    if (out->media) out->media_written = b->media_written - a->media_written;
+}
+
+/* Bytes the device says the host sent it: SMART if present, else the block layer */
+static uint64_t device_host_written(const DevCounters *c) {
+    if (c->smart) return c->data_units_written * 512000ull;
+    return c->valid ? c->sectors_written * 512ull : 0;
+}
+
+/* NAND bytes per host byte, 0 when the drive does not report media writes */
+static double device_wa(const DevCounters *c) {
+    uint64_t host = device_host_written(c);
+    return c->media && host ? (double)c->media_written / (double)host : 0.0;
+}
+
+static void print_device(const char *tag, uint64_t host_bytes, const DevCounters *c) {
+    if (!c->valid && !c->smart) return;
+    printf("[DEVICE] %s: host %.2f MB written", tag, (double)host_bytes / MB);
+    if (c->valid)
+        printf(", block layer %.2f MB written / %.2f MB read in %llu request(s), %llu merged",
+               (double)c->sectors_written * 512 / MB, (double)c->sectors_read * 512 / MB,
+               (unsigned long long)(c->reads + c->writes),
+               (unsigned long long)(c->read_merges + c->write_merges));
+    if (c->smart)
+        printf(", NVMe %.2f MB written", (double)c->data_units_written * 512000 / MB);
+    if (c->media)
+        printf(", NAND %.2f MB => WA %.3f", (double)c->media_written / MB, device_wa(c));
+    printf("\n");
+}
+
+/* ------------------------------------------------------------------ */
+/* Page cache                                                          */
+/* ------------------------------------------------------------------ */
+
+/* System-wide page cache ("Cached:" in /proc/meminfo) in bytes, -1 if unknown */
+static int64_t meminfo_cached(void) {
+    FILE *f = fopen("/proc/meminfo", "r");
+    if (!f) return -1;
+    char               line[128];
+    unsigned long long kb  = 0;
+    int64_t            ret = -1;
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "Cached: %llu kB", &kb) == 1) {
+            ret = (int64_t)kb * 1024;
+            break;
+        }
+    }
+    fclose(f);
+    return ret;
+}
+
+/*
+ * 1 if fd takes RWF_DONTCACHE, 0 if not, -1 (reported) if the probe read
+ * failed for another reason. The flag is checked before EOF, so an empty
+ * file works; fd must be open for reading.
+ */
+static int dontcache_probe(int fd) {
+    uint8_t      buf[ALIGNMENT];
+    struct iovec iov = { buf, sizeof(buf) };
+    if (preadv2(fd, &iov, 1, 0, RWF_DONTCACHE) >= 0) return 1;
+    if (errno == EOPNOTSUPP || errno == EINVAL) return 0;
+    perror("preadv2 (RWF_DONTCACHE probe)");
+    return -1;
+}
+
+/* Write back and drop fd's cached pages, so the next pass starts cold */
+static void page_cache_evict(int fd) {
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+/* ------------------------------------------------------------------ */
+/* Per-region statistics                                               */
+/* ------------------------------------------------------------------ */
+
+/*
+ * --regions=N splits [0, size) into N equal regions and keeps, per worker,
+ * the ops, bytes and a coarse latency histogram of each (two bins per
+ * octave; a full LatHist per region would be too big at high N x qd).
+ * Region throughput is bytes over the time the job spent servicing that
+ * region (summed latency / qd), so regions visited at different times
+ * compare fairly.
+ */
+#define REGION_BINS 80
+
+typedef struct {
+    uint64_t ops;
+    uint64_t bytes;
+    uint64_t lat_sum_ns;
+    uint64_t lat_max_ns;
+    uint64_t bin[REGION_BINS];
+} RegionStats;
+
+static int region_bin(uint64_t ns) {
+    if (ns < 2) return 0;
+    int l = 63 - __builtin_clzll(ns);
+    int b = 2 * l + (int)((ns >> (l - 1)) & 1);
+    return b < REGION_BINS ? b : REGION_BINS - 1;
+}
+
+static void region_add(RegionStats *r, uint64_t bytes, uint64_t ns) {
+    r->ops++;
+    r->bytes      += bytes;
+    r->lat_sum_ns += ns;
+    if (ns > r->lat_max_ns) r->lat_max_ns = ns;
+    r->bin[region_bin(ns)]++;
+}
+
+static void region_merge(RegionStats *dst, const RegionStats *src) {
+    dst->ops        += src->ops;
+    dst->bytes      += src->bytes;
+    dst->lat_sum_ns += src->lat_sum_ns;
+    if (src->lat_max_ns > dst->lat_max_ns) dst->lat_max_ns = src->lat_max_ns;
+    for (int i = 0; i < REGION_BINS; i++) dst->bin[i] += src->bin[i];
+}
+
+/* Midpoint of the bin holding percentile p, in ns */
+static double region_percentile(const RegionStats *r, double p) {
+    if (!r->ops) return 0.0;
+    uint64_t rank = (uint64_t)ceil(p / 100.0 * (double)r->ops), seen = 0;
+    for (int b = 0; b < REGION_BINS; b++) {
+        seen += r->bin[b];
+        if (seen >= rank) {
+            double mid = b < 2 ? (double)b : ldexp(b & 1 ? 1.75 : 1.25, b / 2);
+            return mid < (double)r->lat_max_ns ? mid : (double)r->lat_max_ns;
+        }
+    }
+    return (double)r->lat_max_ns;
+}
+
+static double region_mean_us(const RegionStats *r) {
+    return r->ops ? (double)r->lat_sum_ns / (double)r->ops / 1e3 : 0.0;
+}
+
+static double region_mbps(const RegionStats *r, int qd) {
+    return r->lat_sum_ns ? ((double)r->bytes / MB) / (r->lat_sum_ns / 1e9 / qd) : 0.0;
+}
+
+/* ------------------------------------------------------------------ */
+/* Scan log                                                            */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    uint64_t max_ns;
+    int      cls;            /* worst latency class in the range */
+} SlowRange;
+
+/*
+ * Scan mode: blocks at or above the first latency class are noted here by
+ * the workers (rare, so a mutex is fine) and re-read per logical block
+ * afterwards. The re-read results fill the class counts and slow ranges.
+ */
+typedef struct {
+    uint64_t        class_ns[MAX_CLASSES];   /* upper bounds, ascending */
+    int             nclasses;
+    size_t          sector;
+    pthread_mutex_t lock;
+    uint64_t       *blocks;                  /* offsets of slow blocks */
+    int             nblocks, cap;
+    uint64_t        sectors[MAX_CLASSES + 2]; /* per class, then >= last, then error */
+    SlowRange      *ranges;
+    int             nranges, rcap;
+} ScanLog;
+
+static void scan_note(ScanLog *s, off_t off) {
+    pthread_mutex_lock(&s->lock);
+    if (s->nblocks == s->cap) {
+        s->cap    = s->cap ? s->cap * 2 : 64;
+        s->blocks = realloc(s->blocks, (size_t)s->cap * sizeof(*s->blocks));
+        if (!s->blocks) {
+            perror("realloc (scan)");
+            exit(EXIT_FAILURE);
+        }
+    }
+    s->blocks[s->nblocks++] = (uint64_t)off;
+    pthread_mutex_unlock(&s->lock);
+}
+
+/* ------------------------------------------------------------------ */
+/* Slow I/O capture                                                    */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Every I/O at or above --slow is stored in its worker's ring, oldest
+ * entries overwritten first. The worker is the only writer and publishes
+ * `slow_head` after filling an entry, so a reader copies the window it
+ * sees and drops whatever the worker may have overwritten meanwhile. The
+ * rings are dumped at the end of each job and, on SIGUSR1, while it runs.
+ */
+typedef struct {
+    uint64_t off;
+    uint64_t submit_ns;      /* get_time_ns(); open-loop: the due time */
+    uint64_t complete_ns;
+    uint32_t len;
+    uint16_t rw;
+    uint16_t qd;             /* I/Os in flight in this job at submit, this one included */
+} SlowIo;
+
+static atomic_int slow_dump_req;   /* set by SIGUSR1 */
+
+static void slow_signal(int sig) {
+    (void)sig;
+    atomic_store(&slow_dump_req, 1);
+}
+
+static int cmp_slow(const void *a, const void *b) {
+    const SlowIo *x = a, *y = b;
+    return x->submit_ns < y->submit_ns ? -1 : x->submit_ns > y->submit_ns;
+}
+
+/* ------------------------------------------------------------------ */
+/* Binary I/O trace                                                    */
+/* ------------------------------------------------------------------ */
+
+/*
+ * --trace records every I/O as a fixed-size binary record. Each worker
+ * fills one of its two buffers while the other is being written out; a full
+ * buffer is queued to a single flusher thread, so the hot path never calls
+ * write(). A worker only waits if its other buffer is still queued (counted
+ * as a stall). Every job starts with a TRACE_OP_PHASE record carrying its
+ * name. Records are in host byte order; `snb_dit decode` reads them back.
+ */
+#define TRACE_MAGIC     "SNBTRC01"
+#define TRACE_RECS      4096          /* records per buffer */
+#define TRACE_OP_PHASE  0xFFFF        /* off..complete_ns hold the phase name */
+
+typedef struct {
+    uint64_t off;
+    uint64_t submit_ns;
+    uint64_t complete_ns;
+    uint32_t len;
+    int32_t  result;         /* bytes transferred or -errno */
+    uint16_t op;             /* RwType */
+    uint16_t thread;         /* worker id */
+    uint16_t phase;          /* job number within the run */
+    uint16_t pad;
+} TraceRec;
+
+typedef struct TraceBuf TraceBuf;
+struct TraceBuf {
+    TraceRec  *recs;
+    uint32_t   n;
+    atomic_int busy;         /* queued or being written */
+    TraceBuf  *next;
+};
+
+typedef struct {
+    int             fd;
+    pthread_t       tid;
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    TraceBuf       *head, *tail;
+    int             stop;
+    int             phases;
+    atomic_uint_fast64_t records;
+    atomic_uint_fast64_t stalls;
+    atomic_int      failed;
+} Tracer;
+
+static void trace_write(Tracer *t, const void *buf, size_t len) {
+    const uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = write(t->fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            if (!atomic_exchange(&t->failed, 1)) perror("write (trace)");
+            return;
+        }
+        p   += n;
+        len -= (size_t)n;
+    }
+}
+
+static void *trace_flusher(void *arg) {
+    Tracer *t = arg;
+    pthread_mutex_lock(&t->lock);
+    for (;;) {
+        while (!t->head && !t->stop) pthread_cond_wait(&t->cond, &t->lock);
+        TraceBuf *b = t->head;
+        if (!b) break;
+        t->head = b->next;
+        if (!t->head) t->tail = NULL;
+        pthread_mutex_unlock(&t->lock);
+
+        trace_write(t, b->recs, b->n * sizeof(TraceRec));
+        atomic_fetch_add(&t->records, b->n);
+        b->n = 0;
+        atomic_store_explicit(&b->busy, 0, memory_order_release);
+
+        pthread_mutex_lock(&t->lock);
+    }
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
+
+static int trace_open(Tracer *t, const char *path) {
+    memset(t, 0, sizeof(*t));
+    t->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (t->fd < 0) {
+        perror("open (trace)");
+        return -1;
+    }
+    uint32_t hdr[2] = { sizeof(TraceRec), 0 };
+    trace_write(t, TRACE_MAGIC, 8);
+    trace_write(t, hdr, sizeof(hdr));
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->cond, NULL);
+    if (pthread_create(&t->tid, NULL, trace_flusher, t) != 0) {
+        perror("pthread_create (trace)");
+        close(t->fd);
+        return -1;
+    }
+    return 0;
+}
+
+static void trace_submit(Tracer *t, TraceBuf *b) {
+    atomic_store_explicit(&b->busy, 1, memory_order_relaxed);
+    b->next = NULL;
+    pthread_mutex_lock(&t->lock);
+    if (t->tail) t->tail->next = b;
+    else         t->head = b;
+    t->tail = b;
+    pthread_cond_signal(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+}
+
+static void trace_wait(Tracer *t, TraceBuf *b) {
+    if (!atomic_load_explicit(&b->busy, memory_order_acquire)) return;
+    atomic_fetch_add(&t->stalls, 1);
+    while (atomic_load_explicit(&b->busy, memory_order_acquire)) usleep(50);
+}
+
+/* Phase marker, queued ahead of the job's records; returns the phase number */
+static int trace_phase(Tracer *t, const char *name, TraceBuf *b) {
+    TraceRec r;
+    memset(&r, 0, sizeof(r));
+    r.op    = TRACE_OP_PHASE;
+    pthread_mutex_lock(&t->lock);
+    int id  = t->phases++;   /* burn-in starts jobs from two threads */
+    pthread_mutex_unlock(&t->lock);
+    r.phase = (uint16_t)id;
+    snprintf((char *)&r.off, 3 * sizeof(uint64_t), "%s", name);
+    b->recs[0] = r;
+    b->n       = 1;
+    trace_submit(t, b);
+    trace_wait(t, b);
+    return id;
+}
+
+static void trace_close(Tracer *t) {
+    pthread_mutex_lock(&t->lock);
+    t->stop = 1;
+    pthread_cond_signal(&t->cond);
+    pthread_mutex_unlock(&t->lock);
+    pthread_join(t->tid, NULL);
+    close(t->fd);
+    pthread_mutex_destroy(&t->lock);
+    pthread_cond_destroy(&t->cond);
+}
+
+/* ------------------------------------------------------------------ */
+/* I/O engine: one job = N worker threads issuing synchronous I/O      */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Lets a one-pass write job trail a concurrent one-pass verify of the same
+ * range: the verifier publishes the prefix it has finished reading and the
+ * writer never overwrites a block beyond it.
+ */
+typedef struct {
+    atomic_uint_fast64_t done;   /* bytes [0, done) are safe to overwrite */
+} Fence;
+
+/*
+ * Online queue-depth search: the job starts max_depth workers but only the
+ * first `depth` issue I/O. After every interval the depth grows by one
+ * while p99 is within target_us and halves when it is not (AIMD). Each
+ * interval is credited to the depth it ran at; arrays are max_depth + 1.
+ */
+typedef struct {
+    double  target_us;
+    int     max_depth;
+    int     depth;
+    int    *n;        /* intervals run at each depth */
+    int    *ok;       /* ... of which within target_us */
+    double *iops;     /* ... summed IOPS */
+    double *p99;      /* ... summed p99 (us) */
+} Tuner;
+
+/*
+ * One workload point: queue depth is the number of synchronous workers.
+ * With rate == 0 the job is closed-loop (each worker issues its next I/O as
+ * soon as the previous one completes). With rate > 0 it is open-loop: the
+ * n-th I/O is due at start + n / rate, whichever worker is free picks it up,
+ * and latency is measured from the due time rather than the actual submit,
+ * so time spent queued behind a stalled device is not hidden (no
+ * coordinated omission).
+ */
+typedef struct {
+    const char *name;      /* phase name in reports */
+    RwType      rw;
+    size_t      bs;
+    int         qd;
+    double      runtime;   /* seconds; 0 = one pass over [0, size) */
+    double      rate;      /* target IOPS for open-loop, 0 = closed-loop */
+    int         verify;    /* reads: compare data against the pattern image */
+    int         keep_going;/* verify: count every bad byte instead of stopping */
+    Fence      *fence_out; /* one-pass reads: publish the verified prefix */
+    Fence      *fence_in;  /* one-pass writes: stay behind this prefix */
+    ErrorMap   *errors;    /* failed ranges; recovery only if errors->recover */
+    const SkipTree *skip;  /* --skip: ranges never touched */
+    BlockMap   *written;   /* writes set, verify reads only blocks set; bs must match */
+    const Device *dev;     /* sample device counters before and after the job */
+    uint64_t    slow_ns;   /* capture I/Os at least this slow, 0 = off */
+    int         slow_ring; /* captured I/Os kept per worker */
+    FILE       *slow_out;  /* where captured I/Os are dumped */
+    Tracer     *trace;     /* --trace: record every I/O */
+    int         regions;   /* per-region statistics over [0, size), 0 = off */
+    ScanLog    *scan;      /* note blocks slower than scan->class_ns[0] */
+    const char *progress;  /* progress bar label, NULL for none */
+    double      interval;  /* seconds between interval reports, 0 = off */
+    const Slo  *slo;       /* check the job and each interval, NULL = off */
+    Tuner      *tune;      /* vary the active depth (<= qd) every interval, NULL = off */
+    int         cores;     /* > 0: per-core io_uring engine on this many cores */
+    size_t      steal_unit;/* per-core one-pass: bytes per work unit */
+    LinkKind    link;      /* per-core writes: kernel-chained op after each write */
+    int         buf_ring;  /* per-core reads: provided buffers per core, 0 = one per slot */
+    CacheMode   cache;     /* fd is buffered: plain, or RWF_DONTCACHE on every I/O */
+    int         meminfo;   /* sample the page cache footprint over the job */
+    int         dst_fd;    /* RW_COPY: destination, same offsets as the source */
+} JobSpec;
+
+typedef struct {
+    double   t;            /* seconds since job start */
+    double   iops;
+    double   mbps;
+    double   mean_us;
+    double   stddev_us;
+    double   p50_us;
+    double   p99_us;
+    double   p999_us;
+    double   max_us;
+    int      slo_miss;     /* thresholds missed in this interval */
+    int      kvalid;       /* kernel view below, --device-stats only */
+    double   k_iops;
+    double   k_mbps;
+    double   k_qd;         /* average requests in flight (iostat aqu-sz) */
+    double   k_util;       /* % of the interval with I/O in flight */
+    uint64_t k_merges;
+    uint64_t k_inflight;
+} IntervalSample;
+
+typedef struct {
+    JobSpec         spec;
+    char            label[32]; /* phase name in reports, defaults to spec.name */
+    double          elapsed;
+    double          iops;
+    double          mbps;
+    uint64_t        mismatches;
+    uint64_t        skipped;   /* bytes not read because they are in the error map */
+    uint64_t        unwritten; /* bytes not verified because they were never written */
+    int             spliced;   /* RW_COPY: fell back from copy_file_range to splice */
+    DevCounters     dev;       /* device counter deltas over the job, see JobSpec.dev */
+    uint64_t        slow;      /* I/Os at or above spec.slow_ns, captured or not */
+    RegionStats    *reg;       /* spec.regions entries of region_size bytes */
+    uint64_t        region_size;
+    int             run;       /* --repeat: 1-based run number, 0 without --repeat */
+    int             cores;     /* per-core engine: cores used, spec.qd per core; 0 = workers */
+    int             slo_miss;  /* spec.slo thresholds missed over the whole job */
+    int             slo_iv;    /* intervals that missed a spec.slo threshold */
+    char            slo_why[160];
+    int64_t         cache_peak;  /* spec.meminfo: page cache growth at its highest ... */
+    int64_t         cache_after; /* ... and once the job (and any writeback) ended, bytes */
+    Stats           st;
+    IntervalSample *iv;
+    int             niv;
+} JobResult;
+
+typedef struct Job Job;
+
+static void result_free(JobResult *r) {
+    free(r->iv);
+    free(r->reg);
+}
+
+typedef struct __attribute__((aligned(CACHE_LINE))) {
+    Stats      st;         /* written only by this worker */
+    int        id;
+    Job       *job;
+    uint8_t   *buf;
+    uint64_t   rng;
+    uint64_t   pos;        /* fence_out: lowest block this worker may still read */
+    int        pipefd[2];  /* RW_COPY splice fallback, created on first use */
+    SlowIo    *slow;       /* ring of spec->slow_ring entries */
+    uint64_t   slow_head;  /* entries ever written; slot = head % slow_ring */
+    TraceBuf   tb[2];      /* --trace double buffer */
+    RegionStats *reg;      /* spec->regions entries, read after join */
+    int        tcur;       /* buffer being filled */
+    pthread_t  tid;
+} Worker;
+
+struct Job {
+    const JobSpec    *spec;
+    int               fd;
+    size_t            size;
+    const uint8_t    *pat_img;   /* periodic pattern image, see build_pattern_image */
+    Worker           *workers;
+    int               nworkers;
+    uint64_t          t0_ns;     /* open-loop schedule origin */
+    uint64_t          slot_ns;   /* open-loop inter-arrival time */
+    atomic_uint_fast64_t cursor;
+    atomic_uint_fast64_t mismatches;
+    atomic_uint_fast64_t skipped;
+    atomic_uint_fast64_t unwritten;
+    atomic_int        inflight;  /* slow capture: I/Os currently issued */
+    atomic_int        depth;     /* workers with id >= depth stay idle */
+    int               trace_phase;
+    uint64_t          region_size;
+    atomic_int        active;
+    atomic_int        stop;
+    atomic_int        failed;
+    atomic_int        use_splice;
+};
+
+#define MAX_MISMATCH 10          /* stop verifying after this many bad bytes */
+
+/*
+ * Fast verify path: one memcmp against the pattern image, falling back to a
+ * byte scan only to report the first mismatching bytes of a bad block.
+ */
+static void verify_block(Job *job, const uint8_t *buf, off_t off, size_t len) {
+    const uint8_t *expect = job->pat_img + (size_t)off % CHUNK_SIZE;
+    if (memcmp(buf, expect, len) == 0) return;
+
+    ErrorMap *m = job->spec->errors;
+    if (m) {
+        for (size_t pos = 0; pos < len; pos += m->isolate_bs) {
+            size_t n = len - pos < m->isolate_bs ? len - pos : m->isolate_bs;
+            if (memcmp(buf + pos, expect + pos, n) != 0)
+                errmap_add(m, (uint64_t)off + pos, (uint64_t)off + pos + n, job->spec->rw, 0);
+        }
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        if (buf[i] == expect[i]) continue;
+        uint64_t m = atomic_fetch_add(&job->mismatches, 1);
+        if (m >= MAX_MISMATCH) {
+            if (job->spec->keep_going) continue;
+            return;
+        }
+        fprintf(stderr,
+            "\n  MISMATCH at offset %zu (%.2f MB): "
+            "expected 0x%02X got 0x%02X\n",
+            (size_t)off + i, (double)((size_t)off + i) / MB, expect[i], buf[i]);
+        if (m + 1 == MAX_MISMATCH) {
+            if (job->spec->keep_going) {
+                fprintf(stderr, "  ... (too many mismatches, counting only)\n");
+                continue;
+            }
+            fprintf(stderr, "  ... (too many mismatches, stopping)\n");
+            atomic_store(&job->stop, 1);
+            return;
+        }
+    }
+}
+
+/* Copy [off, off+len) through a pipe with splice(2); returns bytes copied or -1 */
+static ssize_t splice_chunk(Worker *w, off_t off, size_t len) {
+    Job    *job  = w->job;
+    size_t  done = 0;
+
+    if (w->pipefd[0] < 0) {
+        if (pipe2(w->pipefd, O_CLOEXEC) != 0) return -1;
+        fcntl(w->pipefd[1], F_SETPIPE_SZ, 1024 * 1024);   /* best effort */
+    }
+    while (done < len) {
+        loff_t  in = off + (off_t)done;
+        ssize_t n  = splice(job->fd, &in, w->pipefd[1], NULL, len - done, SPLICE_F_MOVE);
+        if (n < 0) return -1;
+        if (n == 0) break;   /* EOF */
+        for (ssize_t left = n; left > 0; ) {
+            loff_t  out = off + (off_t)done;
+            ssize_t m   = splice(w->pipefd[0], NULL, job->spec->dst_fd, &out,
+                                 (size_t)left, SPLICE_F_MOVE);
+            if (m <= 0) return -1;
+            left -= m;
+            done += (size_t)m;
+        }
+    }
+    return (ssize_t)done;
+}
+
+/*
+ * Copy one chunk with copy_file_range(2), which lets the filesystem reflink
+ * or offload the copy. Filesystems or kernels that cannot do it switch the
+ * whole job over to splice.
+ */
+static ssize_t copy_chunk(Worker *w, off_t off, size_t len) {
+    Job    *job  = w->job;
+    size_t  done = 0;
+
+    while (!atomic_load_explicit(&job->use_splice, memory_order_relaxed) && done < len) {
+        loff_t  in  = off + (off_t)done;
+        loff_t  out = off + (off_t)done;
+        ssize_t n   = copy_file_range(job->fd, &in, job->spec->dst_fd, &out, len - done, 0);
+        if (n < 0 && done == 0 &&
+            (errno == ENOSYS || errno == EXDEV || errno == EOPNOTSUPP || errno == EINVAL)) {
+            atomic_store(&job->use_splice, 1);
+            break;
+        }
+        if (n < 0) return -1;
+        if (n == 0) return (ssize_t)done;   /* EOF */
+        done += (size_t)n;
+    }
+    if (done == len) return (ssize_t)done;
+
+    ssize_t n = splice_chunk(w, off + (off_t)done, len - done);
+    return n < 0 ? -1 : (ssize_t)done + n;
+}
+
+/* Advance fence->done to the prefix below every verify worker's position */
+static void fence_publish(Job *job) {
+    uint64_t low = UINT64_MAX;
+    for (int i = 0; i < job->nworkers; i++) {
+        uint64_t p = STAT_GET(job->workers[i].pos);
+        if (p < low) low = p;
+    }
+    uint64_t done = low == UINT64_MAX ? UINT64_MAX : low * job->spec->bs;
+    uint64_t cur  = atomic_load_explicit(&job->spec->fence_out->done, memory_order_relaxed);
+    while (done > cur &&
+           !atomic_compare_exchange_weak_explicit(&job->spec->fence_out->done, &cur, done,
+                                                  memory_order_release, memory_order_relaxed))
+        ;
+}
+
+/* Block until [0, end) has been verified by the job on the other side of the fence */
+static void fence_wait(Job *job, uint64_t end) {
+    while (atomic_load_explicit(&job->spec->fence_in->done, memory_order_acquire) < end &&
+           !atomic_load_explicit(&job->stop, memory_order_relaxed))
+        usleep(100);
+}
+
+/* One I/O of the job's type for [off, off+len); reads land in rbuf */
+static ssize_t job_io(Worker *w, off_t off, size_t len, uint8_t *rbuf) {
+    Job *job = w->job;
+    if (job->spec->rw == RW_COPY)
+        return copy_chunk(w, off, len);
+    if (job->spec->cache == CACHE_DONTCACHE) {
+        struct iovec iov = { rbuf, len };
+        if (!rw_is_write(job->spec->rw)) return preadv2(job->fd, &iov, 1, off, RWF_DONTCACHE);
+        iov.iov_base = (void *)(job->pat_img + (size_t)off % CHUNK_SIZE);
+        return pwritev2(job->fd, &iov, 1, off, RWF_DONTCACHE);
+    }
+    if (rw_is_write(job->spec->rw))
+        return pwrite(job->fd, job->pat_img + (size_t)off % CHUNK_SIZE, len, off);
+    return pread(job->fd, rbuf, len, off);
+}
+
+/* Successful bytes of a read get checked against the pattern */
+static void job_io_done(Worker *w, off_t off, size_t len, const uint8_t *rbuf) {
+    if (w->job->spec->verify) verify_block(w->job, rbuf, off, len);
+}
+
+/* Retry [off, off+len) up to the policy's limit; 0 once an attempt succeeds */
+static int io_retry(Worker *w, off_t off, size_t len, uint8_t *rbuf, int *err) {
+    ErrorMap *m = w->job->spec->errors;
+    for (int i = 0; i < m->retries; i++) {
+        atomic_fetch_add(&m->retried, 1);
+        if (m->delay_ms) usleep((useconds_t)m->delay_ms * 1000);
+        ssize_t r = job_io(w, off, len, rbuf);
+        if (r == (ssize_t)len) {
+            atomic_fetch_add(&m->recovered, 1);
+            return 0;
+        }
+        *err = r < 0 ? errno : EIO;
+    }
+    return -1;
+}
+
+/* Split a failed range in halves until the failing isolate_bs pieces are found */
+static size_t io_isolate(Worker *w, off_t off, size_t len, uint8_t *rbuf, int err) {
+    ErrorMap *m = w->job->spec->errors;
+
+    if (len <= m->isolate_bs) {
+        if (io_retry(w, off, len, rbuf, &err) == 0) {
+            job_io_done(w, off, len, rbuf);
+            return len;
+        }
+        errmap_add(m, (uint64_t)off, (uint64_t)off + len, w->job->spec->rw, err);
+        return 0;
+    }
+
+    size_t half = (len / 2 + m->isolate_bs - 1) / m->isolate_bs * m->isolate_bs;
+    size_t done = 0;
+    for (size_t pos = 0; pos < len; pos += half) {
+        size_t  n = len - pos < half ? len - pos : half;
+        ssize_t r = job_io(w, off + (off_t)pos, n, rbuf + pos);
+        if (r == (ssize_t)n) {
+            job_io_done(w, off + (off_t)pos, n, rbuf + pos);
+            done += n;
+        } else {
+            done += io_isolate(w, off + (off_t)pos, n, rbuf + pos, r < 0 ? errno : EIO);
+        }
+    }
+    return done;
+}
+
+/* Handle a failed I/O under --on-error=continue; returns bytes that completed */
+static size_t io_recover(Worker *w, off_t off, size_t len, uint8_t *rbuf, int err) {
+    if (io_retry(w, off, len, rbuf, &err) == 0) {
+        job_io_done(w, off, len, rbuf);
+        return len;
+    }
+    return io_isolate(w, off, len, rbuf, err);
+}
+
+/* First range to stay out of (failed I/O or skip list) overlapping [a, b) */
+static int job_next_skip(const Job *job, uint64_t a, uint64_t b, uint64_t *s, uint64_t *e) {
+    uint64_t s2, e2;
+    int      found = job->spec->errors && errmap_next(job->spec->errors, a, b, s, e);
+    if (skiptree_next(job->spec->skip, a, b, &s2, &e2) && (!found || s2 < *s)) {
+        *s    = s2;
+        *e    = e2;
+        found = 1;
+    }
+    return found;
+}
+
+/*
+ * Issue [off, off+len) but leave out failed and skip-listed ranges, so a
+ * verify pass checks everything except the sectors known to be bad.
+ */
+static size_t io_around_errors(Worker *w, off_t off, size_t len) {
+    Job      *job  = w->job;
+    uint64_t  pos  = (uint64_t)off;
+    uint64_t  end  = (uint64_t)off + len;
+    size_t    done = 0;
+    uint64_t  s, e;
+
+    while (pos < end) {
+        uint64_t stop = end;
+        if (job_next_skip(job, pos, end, &s, &e)) {
+            if (s <= pos) {
+                uint64_t skip = (e < end ? e : end) - pos;
+                atomic_fetch_add(&job->skipped, skip);
+                pos += skip;
+                continue;
+            }
+            stop = s;
+        }
+        size_t   n    = (size_t)(stop - pos);
+        uint8_t *rbuf = w->buf ? w->buf + (pos - (uint64_t)off) : NULL;
+        ssize_t  r    = job_io(w, (off_t)pos, n, rbuf);
+        if (r == (ssize_t)n) {
+            job_io_done(w, (off_t)pos, n, rbuf);
+            done += n;
+        } else if (job->spec->errors && job->spec->errors->recover) {
+            done += io_recover(w, (off_t)pos, n, rbuf, r < 0 ? errno : EIO);
+        } else {
+            fprintf(stderr, "\n%s at offset %llu failed: %s\n", rw_names[job->spec->rw],
+                    (unsigned long long)pos, r < 0 ? strerror(errno) : "short transfer");
+            atomic_store(&job->failed, 1);
+            atomic_store(&job->stop, 1);
+            return done;
+        }
+        pos = stop;
+    }
+    return done;
+}
+
+static void slow_record(Worker *w, off_t off, size_t len, uint64_t t0, uint64_t t1, int qd) {
+    uint64_t h = w->slow_head;
+    SlowIo  *e = &w->slow[h % (uint64_t)w->job->spec->slow_ring];
+    e->off         = (uint64_t)off;
+    e->len         = (uint32_t)len;
+    e->rw          = (uint16_t)w->job->spec->rw;
+    e->qd          = (uint16_t)qd;
+    e->submit_ns   = t0;
+    e->complete_ns = t1;
+    __atomic_store_n(&w->slow_head, h + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Print the captured I/Os of all workers in submit order. Safe while the
+ * job runs: entries that may have been overwritten during the copy are
+ * dropped.
+ */
+static void slow_dump(const Job *job, int nworkers, const char *label, int live) {
+    const JobSpec *spec  = job->spec;
+    uint64_t       ring  = (uint64_t)spec->slow_ring;
+    SlowIo        *all   = malloc((size_t)nworkers * ring * sizeof(SlowIo));
+    size_t         n     = 0;
+    uint64_t       total = 0;
+    if (!all) {
+        perror("malloc (slow dump)");
+        return;
+    }
+    for (int i = 0; i < nworkers; i++) {
+        const Worker *w    = &job->workers[i];
+        uint64_t      head = __atomic_load_n(&w->slow_head, __ATOMIC_ACQUIRE);
+        uint64_t      from = head > ring ? head - ring : 0;
+        size_t        base = n;
+        for (uint64_t k = from; k < head; k++) all[n++] = w->slow[k % ring];
+        uint64_t again = __atomic_load_n(&w->slow_head, __ATOMIC_ACQUIRE);
+        if (again > ring && again - ring > from) {
+            /* The worker lapped us: drop the slots it may have rewritten */
+            size_t lost = (size_t)(again - ring - from);
+            if (lost > n - base) lost = n - base;
+            memmove(all + base, all + base + lost, (n - base - lost) * sizeof(SlowIo));
+            n -= lost;
+        }
+        total += again;
+    }
+    qsort(all, n, sizeof(SlowIo), cmp_slow);
+
+    /* Map get_time_ns() stamps to wall time for correlation with other logs */
+    struct timespec rt;
+    clock_gettime(CLOCK_REALTIME, &rt);
+    int64_t wall_off = (int64_t)((uint64_t)rt.tv_sec * 1000000000ull + (uint64_t)rt.tv_nsec) -
+                       (int64_t)get_time_ns();
+
+    FILE *f = spec->slow_out;
+    fprintf(f, "# slow I/O %s: phase %s, threshold %.0f us, %llu slow, %zu kept\n",
+            live ? "snapshot" : "dump", label, spec->slow_ns / 1e3,
+            (unsigned long long)total, n);
+    fprintf(f, "# wall_time job_s op offset len lat_us qd\n");
+    for (size_t i = 0; i < n; i++) {
+        const SlowIo *e    = &all[i];
+        int64_t       wall = (int64_t)e->submit_ns + wall_off;
+        time_t        sec  = (time_t)(wall / 1000000000);
+        struct tm     tm;
+        char          ts[32];
+        localtime_r(&sec, &tm);
+        strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%S", &tm);
+        fprintf(f, "%s.%06lld %.6f %s %llu %u %.1f %u\n", ts,
+                (long long)(wall % 1000000000) / 1000,
+                e->submit_ns >= job->t0_ns ? (e->submit_ns - job->t0_ns) / 1e9 : 0.0,
+                rw_names[e->rw], (unsigned long long)e->off, e->len,
+                (e->complete_ns - e->submit_ns) / 1e3, e->qd);
+    }
+    fflush(f);
+    free(all);
+}
+
+static void trace_add(Worker *w, off_t off, size_t len, ssize_t result,
+                      uint64_t t0, uint64_t t1) {
+    TraceBuf *b = &w->tb[w->tcur];
+    TraceRec *r = &b->recs[b->n++];
+    r->off         = (uint64_t)off;
+    r->submit_ns   = t0;
+    r->complete_ns = t1;
+    r->len         = (uint32_t)len;
+    r->result      = (int32_t)result;
+    r->op          = (uint16_t)w->job->spec->rw;
+    r->thread      = (uint16_t)w->id;
+    r->phase       = (uint16_t)w->job->trace_phase;
+    r->pad         = 0;
+    if (b->n == TRACE_RECS) {
+        trace_submit(w->job->spec->trace, b);
+        w->tcur ^= 1;
+        trace_wait(w->job->spec->trace, &w->tb[w->tcur]);
+    }
+}
+
+static void *worker_main(void *arg) {
+    Worker        *w      = arg;
+    Job           *job    = w->job;
+    const JobSpec *spec   = job->spec;
+    size_t         bs     = spec->bs;
+    int            write  = rw_is_write(spec->rw);
+    int            random = rw_is_random(spec->rw);
+    /* Sequential passes include a final partial block, random I/O does not */
+    uint64_t       nblocks = random ? job->size / bs : (job->size + bs - 1) / bs;
+
+    while (!atomic_load_explicit(&job->stop, memory_order_relaxed)) {
+        if (w->id >= atomic_load_explicit(&job->depth, memory_order_relaxed)) {
+            usleep(1000);   /* parked by the tuner */
+            continue;
+        }
+        uint64_t n = atomic_fetch_add_explicit(&job->cursor, 1, memory_order_relaxed);
+        if (spec->runtime <= 0 && n >= nblocks) break;
+        uint64_t blk = random ? rng_next(&w->rng) % nblocks : n % nblocks;
+        off_t    off = (off_t)(blk * bs);
+        size_t   len = job->size - (size_t)off < bs ? job->size - (size_t)off : bs;
+        if (spec->written && !write && !blockmap_test(spec->written, blk)) {
+            atomic_fetch_add_explicit(&job->unwritten, len, memory_order_relaxed);
+            continue;
+        }
+        if (spec->fence_out) STAT_SET(w->pos, blk);
+        if (spec->fence_in) fence_wait(job, (uint64_t)off + len);
+
+        uint64_t t0 = get_time_ns();
+        if (job->slot_ns) {
+            /* Open-loop: n doubles as the arrival slot of this I/O */
+            uint64_t due = job->t0_ns + n * job->slot_ns;
+            if (t0 < due) {
+                sleep_until_ns(due);
+            } else {
+                uint64_t lag = t0 - due;
+                if (lag > w->st.max_lag_ns) STAT_SET(w->st.max_lag_ns, lag);
+                if (lag > job->slot_ns) STAT_ADD(w->st.late, 1);
+            }
+            t0 = due;
+        }
+        ssize_t  r;
+        uint64_t s, e;
+        int      qd     = spec->slow_ns ? atomic_fetch_add(&job->inflight, 1) + 1 : 0;
+        int      around = job_next_skip(job, (uint64_t)off, (uint64_t)off + len, &s, &e);
+        if (around)
+            r = (ssize_t)io_around_errors(w, off, len);
+        else
+            r = job_io(w, off, len, w->buf);
+        int      io_errno = errno;
+        uint64_t t_done   = 0;
+        if (spec->slow_ns || spec->trace) t_done = get_time_ns();
+        if (spec->slow_ns) atomic_fetch_sub(&job->inflight, 1);
+        if (spec->trace) trace_add(w, off, len, r < 0 ? -io_errno : r, t0, t_done);
+
+        if (r != (ssize_t)len && !around) {
+            if (!write && r >= 0 && spec->runtime <= 0) {
+                /* EOF: account what was read, later blocks will stop too */
+                if (spec->verify && r > 0) verify_block(job, w->buf, off, (size_t)r);
+                STAT_ADD(w->st.bytes, (uint64_t)r);
+                break;
+            }
+            if (spec->errors && spec->errors->recover) {
+                r = (ssize_t)io_recover(w, off, len, w->buf, r < 0 ? io_errno : EIO);
+            } else {
+                const char *op = spec->rw == RW_COPY ? "copy" : write ? "write" : "read";
+                if (r < 0)
+                    fprintf(stderr, "\n%s at offset %lld: %s\n",
+                            spec->rw == RW_COPY ? "copy" : write ? "pwrite" : "pread",
+                            (long long)off, strerror(io_errno));
+                else
+                    fprintf(stderr, "\nShort %s at offset %lld: %zd of %zu bytes\n",
+                            op, (long long)off, r, len);
+                atomic_store(&job->failed, 1);
+                atomic_store(&job->stop, 1);
+                break;
+            }
+        } else if (spec->verify && !around) {
+            verify_block(job, w->buf, off, len);
+        }
+        if (around && atomic_load_explicit(&job->failed, memory_order_relaxed)) break;
+        if (write && spec->written && r > 0) blockmap_set(spec->written, blk);
+        uint64_t t1 = get_time_ns();
+        if (spec->slow_ns && t_done - t0 >= spec->slow_ns) slow_record(w, off, len, t0, t_done, qd);
+        hist_add(&w->st.lat, t1 - t0);
+        if (w->reg) region_add(&w->reg[(uint64_t)off / job->region_size], (uint64_t)r, t1 - t0);
+        if (spec->scan && t1 - t0 >= spec->scan->class_ns[0]) scan_note(spec->scan, off);
+        STAT_ADD(w->st.ops, 1);
+        STAT_ADD(w->st.bytes, (uint64_t)r);
+        if (spec->fence_out) {
+            /* The cursor only moves forward, so nothing below blk+1 is left for us */
+            STAT_SET(w->pos, blk + 1);
+            fence_publish(job);
+        }
+    }
+    if (spec->fence_out) {
+        STAT_SET(w->pos, UINT64_MAX);
+        fence_publish(job);
+    }
+    atomic_fetch_sub(&job->active, 1);
+    return NULL;
+}
+
+/* Merge lock-free snapshots of all worker slots; snap is caller scratch */
+static void job_collect(const Worker *workers, int n, Stats *out, Stats *snap) {
+    stats_init(out);
+    for (int i = 0; i < n; i++) {
+        stats_snapshot(snap, &workers[i].st);
+        stats_merge(out, snap);
+    }
+}
+
+/* Kernel side of an interval, from the block layer counters' delta */
+static void interval_kernel(IntervalSample *s, double secs, const DevCounters *k) {
+    s->kvalid     = k->valid;
+    s->k_iops     = (k->reads + k->writes) / secs;
+    s->k_mbps     = (double)(k->sectors_read + k->sectors_written) * 512 / MB / secs;
+    s->k_qd       = k->time_in_queue / (secs * 1e3);
+    s->k_util     = 100.0 * k->io_ticks / (secs * 1e3);
+    s->k_merges   = k->read_merges + k->write_merges;
+    s->k_inflight = k->in_flight;
+}
+
+static void interval_sample(IntervalSample *s, double t, double secs, const Stats *d) {
+    s->t       = t;
+    s->iops    = d->ops / secs;
+    s->mbps    = ((double)d->bytes / MB) / secs;
+    s->mean_us = hist_mean(&d->lat) / 1e3;
+    s->stddev_us = hist_stddev(&d->lat) / 1e3;
+    s->p50_us  = hist_percentile(&d->lat, 50.0) / 1e3;
+    s->p99_us  = hist_percentile(&d->lat, 99.0) / 1e3;
+    s->p999_us = hist_percentile(&d->lat, 99.9) / 1e3;
+    s->max_us  = d->lat.count ? d->lat.max_ns / 1e3 : 0.0;
+}
+
+/* AIMD step after interval s; returns the depth for the next interval */
+static int tune_step(Tuner *t, const IntervalSample *s) {
+    int d = t->depth, ok = s->p99_us <= t->target_us;
+    t->n[d]++;
+    t->ok[d]   += ok;
+    t->iops[d] += s->iops;
+    t->p99[d]  += s->p99_us;
+    t->depth    = ok ? (d < t->max_depth ? d + 1 : d) : (d > 1 ? d / 2 : 1);
+    printf("[TUNE]     depth %4d: %10.0f IOPS  p99 %8.1f us %s -> depth %d\n",
+           d, s->iops, s->p99_us, ok ? "<=" : "> ", t->depth);
+    return t->depth;
+}
+
+/*
+ * Run one job against fd and fill res; returns 0 on success, -1 on I/O error.
+ * The calling thread is the monitor: it draws the progress bar and merges the
+ * workers' slots at every interval boundary while the job runs.
+ */
+static int run_cores_job(int fd, size_t size, const uint8_t *pat_img, const JobSpec *spec,
+                         int ncores, const int *cpus, JobResult *res, double *per_core);
+static int allowed_cpus(int *cpus, int max);
+
+static int run_job(int fd, size_t size, const uint8_t *pat_img,
+                   const JobSpec *spec, JobResult *res) {
+    if (spec->cores) {
+        const char *why = spec->rw == RW_COPY ? "copy" :
+                          spec->runtime <= 0 && rw_is_random(spec->rw) ? "one-pass random I/O" :
+                          spec->errors && spec->errors->recover ? "--on-error=continue" :
+                          spec->skip && spec->skip->n ? "--skip" :
+                          spec->fence_in || spec->fence_out ? "burnin" :
+                          spec->rate > 0 ? "--rate" : spec->interval > 0 ? "--interval" :
+                          spec->slow_ns ? "--slow" : spec->trace ? "--trace" :
+                          spec->regions ? "--regions" : spec->scan ? "scan" :
+                          spec->tune ? "tune" : spec->cache ? "--cache" : NULL;
+        if (why) {
+            fprintf(stderr, "--cores: %s is not supported by the per-core engine\n", why);
+            memset(res, 0, sizeof(*res));
+            return -1;
+        }
+        int cpus[MAX_QD], ncpu = allowed_cpus(cpus, MAX_QD);
+        return run_cores_job(fd, size, pat_img, spec, spec->cores,
+                             spec->cores <= ncpu ? cpus : NULL, res, NULL);
+    }
+
+    Job job;
+    job.spec    = spec;
+    job.fd      = fd;
+    job.size    = size;
+    job.pat_img = pat_img;
+    job.slot_ns = spec->rate > 0 ? (uint64_t)(1e9 / spec->rate) : 0;
+    job.t0_ns   = get_time_ns();
+    atomic_init(&job.cursor, 0);
+    atomic_init(&job.mismatches, 0);
+    atomic_init(&job.skipped, 0);
+    atomic_init(&job.unwritten, 0);
+    atomic_init(&job.inflight, 0);
+    atomic_init(&job.active, 0);
+    atomic_init(&job.stop, 0);
+    atomic_init(&job.failed, 0);
+    atomic_init(&job.use_splice, 0);
+    atomic_init(&job.depth, spec->tune ? spec->tune->depth : spec->qd);
+
+    memset(res, 0, sizeof(*res));
+    res->spec = *spec;
+    snprintf(res->label, sizeof(res->label), "%s", spec->name);
+    stats_init(&res->st);
+
+    Worker *workers = aligned_alloc(CACHE_LINE, (size_t)spec->qd * sizeof(Worker));
+    if (!workers) {
+        perror("aligned_alloc (workers)");
+        return -1;
+    }
+    memset(workers, 0, (size_t)spec->qd * sizeof(Worker));
+    job.workers  = workers;
+    job.nworkers = spec->qd;
+    job.trace_phase = 0;
+    job.region_size = spec->regions ? (size + (size_t)spec->regions - 1) / (size_t)spec->regions : 0;
+
+    if (spec->trace) {
+        TraceBuf hdr = { .recs = &(TraceRec){ 0 } };
+        job.trace_phase = trace_phase(spec->trace, spec->name, &hdr);
+    }
+
+    DevCounters dev0, kprev;
+    if (spec->dev) {
+        device_read(spec->dev, &dev0);
+        kprev = dev0;
+    }
+
+    int64_t cache0 = spec->meminfo ? meminfo_cached() : 0, cache_hi = cache0;
+    double  t_start = get_time_sec();
+    int     started = 0;
+    for (int i = 0; i < spec->qd; i++) {
+        Worker *w = &workers[i];
+        w->id  = i;
+        w->job = &job;
+        w->rng = 0x9E3779B97F4A7C15ull * (uint64_t)(i + 1) ^ get_time_ns();
+        w->pipefd[0] = w->pipefd[1] = -1;
+        stats_init(&w->st);
+        if (spec->trace) {
+            for (int k = 0; k < 2; k++) {
+                w->tb[k].recs = malloc(TRACE_RECS * sizeof(TraceRec));
+                atomic_init(&w->tb[k].busy, 0);
+            }
+            if (!w->tb[0].recs || !w->tb[1].recs) {
+                perror("malloc (trace buffer)");
+                atomic_store(&job.failed, 1);
+                break;
+            }
+        }
+        if (spec->regions && !(w->reg = calloc((size_t)spec->regions, sizeof(RegionStats)))) {
+            perror("calloc (regions)");
+            atomic_store(&job.failed, 1);
+            break;
+        }
+        if (spec->slow_ns) {
+            w->slow = malloc((size_t)spec->slow_ring * sizeof(SlowIo));
+            if (!w->slow) {
+                perror("malloc (slow ring)");
+                atomic_store(&job.failed, 1);
+                break;
+            }
+        }
+        if (spec->rw != RW_COPY && !rw_is_write(spec->rw) &&
+            posix_memalign((void **)&w->buf, ALIGNMENT, spec->bs) != 0) {
+            perror("posix_memalign (worker)");
+            atomic_store(&job.failed, 1);
+            break;
+        }
+        atomic_fetch_add(&job.active, 1);
+        if (pthread_create(&w->tid, NULL, worker_main, w) != 0) {
+            perror("pthread_create");
+            atomic_fetch_sub(&job.active, 1);
+            free(w->buf);
+            w->buf = NULL;
+            atomic_store(&job.failed, 1);
+            break;
+        }
+        started++;
+    }
+    if (started < spec->qd) atomic_store(&job.stop, 1);
+
+    /* Time based jobs run until the deadline, one-pass jobs until done */
+    Stats  *prev    = malloc(sizeof(Stats));
+    Stats  *cur     = malloc(sizeof(Stats));
+    Stats  *delta   = malloc(sizeof(Stats));
+    double  next_iv = spec->interval;
+    double  last_iv = 0.0;
+    int     cap_iv  = 0;
+    if (!prev || !cur || !delta) {
+        perror("malloc (monitor stats)");
+        atomic_store(&job.failed, 1);
+        atomic_store(&job.stop, 1);
+    } else {
+        stats_init(prev);
+    }
+    while (prev && cur && delta && atomic_load(&job.active) > 0) {
+        double now = get_time_sec() - t_start;
+        if (spec->runtime > 0 && now >= spec->runtime) break;
+        usleep(10000);
+        if (spec->meminfo) {
+            int64_t c = meminfo_cached();
+            if (c > cache_hi) cache_hi = c;
+        }
+        if (spec->slow_ns && atomic_exchange(&slow_dump_req, 0))
+            slow_dump(&job, started, spec->name, 1);
+
+        if (spec->progress) {
+            job_collect(workers, started, cur, delta);
+            print_progress(spec->progress, cur->bytes + atomic_load(&job.unwritten), size);
+        }
+        if (spec->interval > 0 && now >= next_iv) {
+            job_collect(workers, started, cur, delta);
+            stats_delta(delta, cur, prev);
+            if (res->niv == cap_iv) {
+                int             cap = cap_iv ? cap_iv * 2 : 16;
+                IntervalSample *iv  = realloc(res->iv, (size_t)cap * sizeof(IntervalSample));
+                if (!iv) {
+                    perror("realloc (intervals)");
+                    atomic_store(&job.failed, 1);
+                    atomic_store(&job.stop, 1);
+                    break;
+                }
+                res->iv = iv;
+                cap_iv  = cap;
+            }
+            IntervalSample *s = &res->iv[res->niv++];
+            interval_sample(s, now, now - last_iv, delta);
+            printf("%s[INTERVAL] %-10s t=%7.1fs %10.0f IOPS %9.2f MB/s"
+                   "  p50 %8.1f us  p99 %8.1f us  max %8.1f us\n",
+                   spec->progress ? "\n" : "", spec->name, s->t, s->iops, s->mbps,
+                   s->p50_us, s->p99_us, s->max_us);
+            if (spec->slo) {
+                char why[160];
+                s->slo_miss = slo_check(spec->slo, s->iops, s->mbps, s->p99_us, s->p999_us,
+                                        s->stddev_us, why, sizeof(why));
+                if (s->slo_miss) {
+                    res->slo_iv++;
+                    printf("[SLO]      %-10s t=%7.1fs MISSED: %s\n", spec->name, s->t, why);
+                }
+            }
+            if (spec->tune) atomic_store(&job.depth, tune_step(spec->tune, s));
+            if (spec->dev) {
+                DevCounters know, kd;
+                memset(&know, 0, sizeof(know));
+                device_read_stat(spec->dev, &know);
+                device_delta(&kd, &kprev, &know);
+                kprev = know;
+                interval_kernel(s, now - last_iv, &kd);
+            }
+            if (s->kvalid) {
+                /* Beyond 10% apart the two are not measuring the same I/O */
+                double ratio = s->mbps > 0 ? s->k_mbps / s->mbps : 0.0;
+                printf("[KERNEL]   %-10s t=%7.1fs %10.0f IOPS %9.2f MB/s"
+                       "  aqu %6.2f  util %5.1f%%  merges %llu  inflight %llu%s\n",
+                       spec->dev->name, s->t, s->k_iops, s->k_mbps, s->k_qd, s->k_util,
+                       (unsigned long long)s->k_merges, (unsigned long long)s->k_inflight,
+                       s->mbps <= 0 || (ratio > 0.9 && ratio < 1.1) ? "" :
+                       ratio < 0.9 ? "  << kernel saw less: page cache?" :
+                                     "  << kernel saw more: readahead or other I/O?");
+                if (s->k_merges || (s->iops > 0 && fabs(s->k_iops / s->iops - 1.0) > 0.1))
+                    printf("[KERNEL]   %-10s requests/op %.2f (merged or split by the block layer)\n",
+                           "", s->iops > 0 ? s->k_iops / s->iops : 0.0);
+            }
+            fflush(stdout);
+            Stats *tmp = prev; prev = cur; cur = tmp;
+            last_iv  = now;
+            next_iv += spec->interval;
+        }
+    }
+    atomic_store(&job.stop, 1);
+    if (spec->fence_out && started < spec->qd)
+        atomic_store(&spec->fence_out->done, UINT64_MAX);
+
+    for (int i = 0; i < started; i++) pthread_join(workers[i].tid, NULL);
+    if (spec->slow_ns) {
+        for (int i = 0; i < started; i++) res->slow += workers[i].slow_head;
+        if (res->slow) slow_dump(&job, started, spec->name, 0);
+    }
+    for (int i = 0; i < spec->qd; i++) free(workers[i].slow);
+    if (spec->regions) {
+        res->reg         = calloc((size_t)spec->regions, sizeof(RegionStats));
+        res->region_size = job.region_size;
+        if (!res->reg) {
+            perror("calloc (regions)");
+            atomic_store(&job.failed, 1);
+        }
+        for (int i = 0; i < spec->qd; i++) {
+            for (int k = 0; res->reg && workers[i].reg && k < spec->regions; k++)
+                region_merge(&res->reg[k], &workers[i].reg[k]);
+            free(workers[i].reg);
+        }
+    }
+    for (int i = 0; spec->trace && i < spec->qd; i++) {
+        Worker *w = &workers[i];
+        if (w->tb[w->tcur].n) trace_submit(spec->trace, &w->tb[w->tcur]);
+        for (int k = 0; k < 2; k++) {
+            if (w->tb[k].recs) trace_wait(spec->trace, &w->tb[k]);
+            free(w->tb[k].recs);
+        }
+    }
+    for (int i = 0; i < started; i++) {
+        stats_merge(&res->st, &workers[i].st);
+        free(workers[i].buf);
+        if (workers[i].pipefd[0] >= 0) {
+            close(workers[i].pipefd[0]);
+            close(workers[i].pipefd[1]);
+        }
+    }
+    /* Buffered writes are not done until they reach the device */
+    if (spec->cache && rw_is_write(spec->rw) && fdatasync(fd) != 0) {
+        perror("fdatasync");
+        atomic_store(&job.failed, 1);
+    }
+    if (spec->meminfo && cache0 >= 0) {
+        int64_t c        = meminfo_cached();
+        res->cache_peak  = (c > cache_hi ? c : cache_hi) - cache0;
+        res->cache_after = c - cache0;
+    }
+    if (spec->dev) {
+        DevCounters dev1;
+        device_read(spec->dev, &dev1);
+        device_delta(&res->dev, &dev0, &dev1);
+    }
+    res->elapsed    = get_time_sec() - t_start;
+    res->iops       = res->st.ops / res->elapsed;
+    res->mbps       = ((double)res->st.bytes / MB) / res->elapsed;
+    res->mismatches = atomic_load(&job.mismatches);
+    res->spliced    = atomic_load(&job.use_splice);
+    res->skipped    = atomic_load(&job.skipped);
+    res->unwritten  = atomic_load(&job.unwritten);
+    if (res->mismatches > MAX_MISMATCH && !spec->keep_going) res->mismatches = MAX_MISMATCH;
+    if (spec->slo)
+        res->slo_miss = slo_check(spec->slo, res->iops, res->mbps,
+                                  hist_percentile(&res->st.lat, 99.0) / 1e3,
+                                  hist_percentile(&res->st.lat, 99.9) / 1e3,
+                                  hist_stddev(&res->st.lat) / 1e3,
+                                  res->slo_why, sizeof(res->slo_why));
+    if (spec->progress && spec->runtime <= 0)
+        print_progress(spec->progress, res->st.bytes + res->unwritten, size);
+    else if (spec->progress)
+        print_progress(spec->progress, res->st.bytes, size);
+
+    free(prev); free(cur); free(delta);
+    free(workers);
+    return atomic_load(&job.failed) ? -1 : 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* Per-core engine: one pinned thread, io_uring and LBA slice per core */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Shared-nothing counterpart of run_job(): each core thread creates its own
+ * ring (so the kernel may treat it as single-issuer) and allocates its own
+ * buffer arena. It keeps qd I/Os in flight and runs each completion to the
+ * next submission without locks; a time-based job only touches the core's
+ * own slice [lo, lo + nblocks * bs) and shares nothing but the stop flag.
+ * Raw syscalls, no liburing.
+ */
+typedef struct {
+    int                  fd;
+    unsigned            *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned            *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void                *sq_map, *cq_map;
+    size_t               sq_len, cq_len, sqes_len;
+    unsigned             sq_local;   /* tail including unpublished entries */
+} Ring;
+
+static int ring_init(Ring *r, unsigned entries) {
+    struct io_uring_params p;
+    memset(r, 0, sizeof(*r));
+    memset(&p, 0, sizeof(p));
+#ifdef IORING_SETUP_DEFER_TASKRUN
+    p.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+#endif
+    r->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (r->fd < 0 && errno == EINVAL && p.flags) {
+        memset(&p, 0, sizeof(p));
+        r->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    }
+    if (r->fd < 0) return -1;
+
+    r->sq_len   = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_len   = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        r->sq_len = r->cq_len = r->sq_len > r->cq_len ? r->sq_len : r->cq_len;
+    r->sq_map = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     r->fd, IORING_OFF_SQ_RING);
+    r->cq_map = p.features & IORING_FEAT_SINGLE_MMAP ? r->sq_map :
+                mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     r->fd, IORING_OFF_CQ_RING);
+    r->sqes   = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     r->fd, IORING_OFF_SQES);
+    if (r->sq_map == MAP_FAILED || r->cq_map == MAP_FAILED || r->sqes == MAP_FAILED) {
+        int e = errno;
+        close(r->fd);
+        errno = e;
+        return -1;
+    }
+    uint8_t *sq = r->sq_map, *cq = r->cq_map;
+    r->sq_head  = (unsigned *)(sq + p.sq_off.head);
+    r->sq_tail  = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_mask  = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + p.sq_off.array);
+    r->cq_head  = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail  = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask  = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes     = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    r->sq_local = *r->sq_tail;
+    return 0;
+}
+
+static void ring_free(Ring *r) {
+    munmap(r->sqes, r->sqes_len);
+    if (r->cq_map != r->sq_map) munmap(r->cq_map, r->cq_len);
+    munmap(r->sq_map, r->sq_len);
+    close(r->fd);
+}
+
+/* Next free SQE; the caller keeps at most sq_entries in flight */
+static struct io_uring_sqe *ring_sqe(Ring *r) {
+    unsigned idx = r->sq_local++ & *r->sq_mask;
+    r->sq_array[idx] = idx;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+/* Publish queued SQEs and wait for at least min_complete completions */
+static int ring_enter(Ring *r, unsigned min_complete) {
+    unsigned n = r->sq_local - *r->sq_tail;
+    __atomic_store_n(r->sq_tail, r->sq_local, __ATOMIC_RELEASE);
+    for (;;) {
+        int ret = (int)syscall(__NR_io_uring_enter, r->fd, n, min_complete,
+                               min_complete ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (ret >= 0 || errno != EINTR) return ret < 0 ? -1 : 0;
+        n = 0;
+    }
+}
+
+/*
+ * Provided buffer ring (IORING_REGISTER_PBUF_RING, Linux 5.19+): a read
+ * submitted with IOSQE_BUFFER_SELECT takes a buffer from group 0 when the
+ * kernel issues it and names it in the CQE, so buffers are only held by
+ * I/Os actually running, not by every queued one.
+ */
+typedef struct {
+    struct io_uring_buf_ring *br;
+    unsigned                  mask;   /* ring entries - 1 */
+    uint16_t                  tail;
+} PBuf;
+
+/* Hand buffer bid of arena back to the kernel */
+static void pbuf_put(PBuf *p, uint8_t *arena, int bid, size_t bs) {
+    struct io_uring_buf *b = &p->br->bufs[p->tail & p->mask];
+    b->addr = (uint64_t)(uintptr_t)(arena + (size_t)bid * bs);
+    b->len  = (uint32_t)bs;
+    b->bid  = (uint16_t)bid;
+    __atomic_store_n(&p->br->tail, ++p->tail, __ATOMIC_RELEASE);
+}
+
+/* Register nbuf buffers of bs bytes from arena as group 0 of ring r */
+static int pbuf_init(PBuf *p, Ring *r, uint8_t *arena, int nbuf, size_t bs) {
+    unsigned entries = 1;
+    while (entries < (unsigned)nbuf) entries <<= 1;
+    memset(p, 0, sizeof(*p));
+    if (posix_memalign((void **)&p->br, 4096, entries * sizeof(struct io_uring_buf)) != 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    memset(p->br, 0, entries * sizeof(struct io_uring_buf));
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr    = (uint64_t)(uintptr_t)p->br;
+    reg.ring_entries = entries;
+    if (syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        int e = errno;
+        free(p->br);
+        errno = e;
+        return -1;
+    }
+    p->mask = entries - 1;
+    for (int i = 0; i < nbuf; i++) pbuf_put(p, arena, i, bs);
+    return 0;
+}
+
+/*
+ * One-pass jobs are scheduled by work stealing rather than static slices,
+ * so a slow core, device or NUMA node cannot hold up the finish: [0, size)
+ * is cut into units of spec->steal_unit bytes, each core starts with an
+ * equal run of units and takes them front first; a core that runs dry
+ * takes the back half of the fullest deque. A deque is a single atomic
+ * word (next unit << 32 | end unit), so owner and thieves both just CAS.
+ */
+typedef struct __attribute__((aligned(CACHE_LINE))) {
+    atomic_uint_fast64_t units;
+} Deque;
+
+#define DEQUE(h, t) ((uint64_t)(h) << 32 | (uint64_t)(t))
+
+/* Take the front unit; -1 when empty */
+static int64_t deque_pop(Deque *d) {
+    uint64_t r = atomic_load_explicit(&d->units, memory_order_relaxed);
+    for (;;) {
+        uint32_t h = (uint32_t)(r >> 32), t = (uint32_t)r;
+        if (h >= t) return -1;
+        if (atomic_compare_exchange_weak(&d->units, &r, DEQUE(h + 1, t))) return h;
+    }
+}
+
+/* Move the back half of the fullest other deque into the empty deque `self` */
+static int deque_steal(Deque *deques, int n, int self) {
+    for (;;) {
+        int      victim = -1;
+        uint64_t most   = 0, r = 0;
+        for (int i = 0; i < n; i++) {
+            uint64_t v    = atomic_load_explicit(&deques[i].units, memory_order_relaxed);
+            uint64_t left = (uint32_t)v > (uint32_t)(v >> 32) ? (uint32_t)v - (uint32_t)(v >> 32) : 0;
+            if (i != self && left > most) {
+                most   = left;
+                victim = i;
+                r      = v;
+            }
+        }
+        if (victim < 0) return 0;
+        uint32_t h = (uint32_t)(r >> 32), t = (uint32_t)r, k = (uint32_t)((most + 1) / 2);
+        if (atomic_compare_exchange_strong(&deques[victim].units, &r, DEQUE(h, t - k))) {
+            atomic_store(&deques[self].units, DEQUE(t - k, t));
+            return (int)k;
+        }
+    }
+}
+
+typedef struct {
+    const JobSpec    *spec;
+    int               fd;
+    size_t            size;
+    const uint8_t    *pat_img;
+    atomic_int        ready;       /* cores set up and waiting for go */
+    atomic_int        go;          /* set once every started core is ready */
+    Job               vj;          /* verify_block() state; vj.stop ends the job */
+    LinkKind          link;        /* spec->link for writes, else LINK_NONE */
+    int               nbuf;        /* spec->buf_ring for reads, else 0 */
+    Deque            *deques;      /* one-pass: per core, NULL for time-based jobs */
+    int               ncores;
+    uint64_t          unit_blocks; /* one-pass: blocks per unit */
+    uint64_t          nblocks;     /* one-pass: blocks in [0, size), last may be partial */
+    atomic_int        active;
+} CoreJob;
+
+typedef struct __attribute__((aligned(CACHE_LINE))) {
+    Stats      st;         /* written only by this core */
+    CoreJob   *job;
+    int        id;
+    int        cpu;        /* pinned to this CPU, -1 = not pinned */
+    uint64_t   lo;         /* time-based: first byte of this core's slice */
+    uint64_t   nblocks;    /* time-based: slice length in blocks */
+    uint64_t   next;       /* next block: in the slice, or in the current unit */
+    uint64_t   end;        /* one-pass: end of the current unit */
+    uint64_t   rng;
+    uint64_t   units;      /* one-pass: units completed here ... */
+    uint64_t   stolen;     /* ... of which stolen from other cores */
+    uint64_t   unwritten;  /* bytes skipped, never written per spec->written */
+    uint64_t   starved;    /* reads requeued for want of a provided buffer */
+    int        err;        /* errno of the first failure */
+    const char *what;      /* ... and where it happened */
+    pthread_t  tid;
+} Core;
+
+/* Per in-flight slot: one I/O, or a write and the op linked behind it */
+typedef struct {
+    uint64_t t0;
+    uint64_t off;
+    uint32_t len;
+    uint8_t  pending;  /* CQEs still to come */
+    uint8_t  failed;
+} CoreSlot;
+
+/* Next block for a one-pass job, -1 when no work is left anywhere */
+static int64_t core_next_block(Core *c) {
+    CoreJob *job = c->job;
+    while (c->next >= c->end) {
+        int64_t u = deque_pop(&job->deques[c->id]);
+        if (u < 0) {
+            int k = deque_steal(job->deques, job->ncores, c->id);
+            if (k == 0) return -1;
+            c->stolen += (uint64_t)k;
+            continue;
+        }
+        c->units++;
+        c->next = (uint64_t)u * job->unit_blocks;
+        c->end  = c->next + job->unit_blocks < job->nblocks ? c->next + job->unit_blocks
+                                                           : job->nblocks;
+    }
+    return (int64_t)c->next++;
+}
+
+/*
+ * Queue the SQE(s) for the I/O described by slot. With job->link the write
+ * carries IOSQE_IO_LINK, so the kernel starts the fsync or read-back only
+ * after the write completed in full, without a trip through userspace;
+ * user_data bit 0 tells the two CQEs apart. With job->nbuf a read leaves
+ * the buffer choice to the kernel.
+ */
+static void core_issue(Core *c, Ring *r, uint8_t *arena, CoreSlot *slots, int slot) {
+    const CoreJob *job  = c->job;
+    const JobSpec *spec = job->spec;
+    CoreSlot      *s    = &slots[slot];
+    /* Writes go straight from the pattern image, like job_io() */
+    const uint8_t *buf = rw_is_write(spec->rw) ? job->pat_img + s->off % CHUNK_SIZE :
+                         job->nbuf ? NULL : arena + (size_t)slot * spec->bs;
+    struct io_uring_sqe *sqe = ring_sqe(r);
+    sqe->opcode    = rw_is_write(spec->rw) ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd        = job->fd;
+    sqe->addr      = (uint64_t)(uintptr_t)buf;
+    sqe->len       = s->len;
+    sqe->off       = s->off;
+    sqe->user_data = (uint64_t)slot << 1;
+    if (!buf) sqe->flags |= IOSQE_BUFFER_SELECT;
+    s->pending = 1;
+    if (job->link) {
+        sqe->flags |= IOSQE_IO_LINK;
+        sqe = ring_sqe(r);
+        sqe->fd        = job->fd;
+        sqe->user_data = (uint64_t)slot << 1 | 1;
+        if (job->link == LINK_READ) {
+            sqe->opcode = IORING_OP_READ;
+            sqe->addr   = (uint64_t)(uintptr_t)(arena + (size_t)slot * spec->bs);
+            sqe->len    = s->len;
+            sqe->off    = s->off;
+        } else {
+            sqe->opcode      = IORING_OP_FSYNC;
+            sqe->fsync_flags = job->link == LINK_FDATASYNC ? IORING_FSYNC_DATASYNC : 0;
+        }
+        s->pending = 2;
+    }
+}
+
+/* Queue the next I/O into slot; 0 when a one-pass job has nothing left */
+static int core_prep(Core *c, Ring *r, uint8_t *arena, CoreSlot *slots, int slot) {
+    const CoreJob *job  = c->job;
+    const JobSpec *spec = job->spec;
+    uint64_t       off;
+    size_t         len  = spec->bs;
+    if (job->deques) {
+        int64_t blk;
+        for (;;) {
+            if ((blk = core_next_block(c)) < 0) return 0;
+            off = (uint64_t)blk * spec->bs;
+            len = job->size - off < spec->bs ? job->size - off : spec->bs;
+            if (!spec->written || rw_is_write(spec->rw) || blockmap_test(spec->written, (uint64_t)blk))
+                break;
+            c->unwritten += len;
+        }
+    } else {
+        uint64_t blk = rw_is_random(spec->rw) ? rng_next(&c->rng) % c->nblocks
+                                              : c->next++ % c->nblocks;
+        off = c->lo + blk * spec->bs;
+    }
+    slots[slot] = (CoreSlot){ get_time_ns(), off, (uint32_t)len, 0, 0 };
+    core_issue(c, r, arena, slots, slot);
+    return 1;
+}
+
+static void *core_main(void *arg) {
+    Core          *c     = arg;
+    CoreJob       *job   = c->job;
+    const JobSpec *spec  = job->spec;
+    int            qd    = spec->qd;
+    int            nbuf  = job->nbuf ? job->nbuf : qd;
+    Ring           ring;
+    PBuf           pbuf  = { 0 };
+    uint8_t       *arena = NULL;
+    CoreSlot      *slots = calloc((size_t)qd, sizeof(CoreSlot));
+    int           *park  = calloc((size_t)qd, sizeof(int));
+    int            nparked = 0;
+
+    if (c->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(c->cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+    /* Ring and arena are created on the core that uses them */
+    if (!slots || !park) {
+        c->err  = ENOMEM;
+        c->what = "calloc (slots)";
+    } else if (ring_init(&ring, (unsigned)qd * (job->link ? 2 : 1)) != 0) {
+        c->err  = errno;
+        c->what = "io_uring_setup";
+    } else if (posix_memalign((void **)&arena, ALIGNMENT, (size_t)nbuf * spec->bs) != 0) {
+        c->err  = ENOMEM;
+        c->what = "posix_memalign";
+        ring_free(&ring);
+    } else if (job->nbuf && pbuf_init(&pbuf, &ring, arena, nbuf, spec->bs) != 0) {
+        c->err  = errno;
+        c->what = "IORING_REGISTER_PBUF_RING";
+        ring_free(&ring);
+        free(arena);
+    }
+    atomic_fetch_add(&job->ready, 1);
+    while (!atomic_load(&job->go)) usleep(50);
+    if (c->err || atomic_load(&job->vj.stop)) {
+        /* Called off before the start: not every core could be started */
+        if (!c->err) {
+            ring_free(&ring);
+            free(pbuf.br);
+            free(arena);
+        }
+        free(park);
+        free(slots);
+        atomic_fetch_sub(&job->active, 1);
+        return NULL;
+    }
+
+    /* inflight counts busy slots, nparked of them waiting for a provided buffer */
+    int inflight = 0;
+    while (inflight < qd && core_prep(c, &ring, arena, slots, inflight)) inflight++;
+    while (inflight > 0) {
+        if (ring_enter(&ring, 1) != 0) {
+            c->err  = errno;
+            c->what = "io_uring_enter";
+            break;
+        }
+        int      stop     = atomic_load_explicit(&job->vj.stop, memory_order_relaxed) || c->err;
+        int      recycled = 0;
+        unsigned head     = *ring.cq_head;
+        unsigned tail     = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            const struct io_uring_cqe *cqe    = &ring.cqes[head & *ring.cq_mask];
+            int                        slot   = (int)(cqe->user_data >> 1);
+            int                        linked = (int)(cqe->user_data & 1);
+            CoreSlot                  *s      = &slots[slot];
+            uint64_t                   now    = get_time_ns();
+            int want = linked && job->link != LINK_READ ? 0 : (int)s->len;
+            int bid  = cqe->flags & IORING_CQE_F_BUFFER ? (int)(cqe->flags >> IORING_CQE_BUFFER_SHIFT)
+                                                        : -1;
+            if (cqe->res == -ENOBUFS && job->nbuf) {
+                /* Every buffer is taken: retry once one comes back */
+                c->starved++;
+                park[nparked++] = slot;
+                continue;
+            }
+            /* A failed write cancels its linked op: report only the first CQE */
+            if (cqe->res != want && !s->failed) {
+                s->failed = 1;
+                if (!c->err) {
+                    c->err  = cqe->res < 0 ? -cqe->res : EIO;
+                    c->what = linked ? link_names[job->link] :
+                              rw_is_write(spec->rw) ? "write" : "read";
+                    fprintf(stderr, "\n%s at offset %llu: %s\n", c->what,
+                            (unsigned long long)s->off, strerror(c->err));
+                }
+                stop = 1;
+            }
+            int done = --s->pending == 0;
+            if (done && !s->failed && (spec->verify || job->link == LINK_READ))
+                verify_block(&job->vj, arena + (size_t)(bid >= 0 ? bid : slot) * spec->bs,
+                             (off_t)s->off, s->len);
+            if (bid >= 0) {
+                pbuf_put(&pbuf, arena, bid, spec->bs);
+                recycled++;
+            }
+            if (!done) continue;
+            inflight--;
+            if (s->failed) continue;
+            if (spec->written && rw_is_write(spec->rw))
+                blockmap_set(spec->written, s->off / spec->bs);
+            hist_add(&c->st.lat, now - s->t0);
+            STAT_ADD(c->st.ops, 1);
+            STAT_ADD(c->st.bytes, s->len);
+            if (!stop && core_prep(c, &ring, arena, slots, slot)) inflight++;
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+        /*
+         * Reissue as many parked reads as buffers came back, or all of them
+         * if nothing else is in the kernel to wake us; their latency keeps
+         * counting from the first submission.
+         */
+        if (stop) {
+            inflight -= nparked;
+            nparked   = 0;
+        }
+        int retry = inflight == nparked ? nparked : recycled < nparked ? recycled : nparked;
+        for (int i = 0; i < retry; i++) core_issue(c, &ring, arena, slots, park[--nparked]);
+    }
+    if (inflight > 0) {
+        /* io_uring_enter failed: the ring still owns the buffers, keep them */
+        close(ring.fd);
+    } else {
+        ring_free(&ring);
+        free(pbuf.br);
+        free(arena);
+    }
+    free(park);
+    free(slots);
+    if (c->err) atomic_store(&job->vj.stop, 1);
+    atomic_fetch_sub(&job->active, 1);
+    return NULL;
+}
+
+/* CPUs this process may run on, in order; returns the count */
+static int allowed_cpus(int *cpus, int max) {
+    cpu_set_t set;
+    int       n = 0;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return 0;
+    for (int c = 0; c < CPU_SETSIZE && n < max; c++)
+        if (CPU_ISSET(c, &set)) cpus[n++] = c;
+    return n;
+}
+
+/*
+ * Run spec with spec->qd in flight on each of ncores cores, pinned to the
+ * matching entry of cpus (NULL = unpinned). A time-based job gives every
+ * core an equal block-aligned slice of [0, size); a one-pass job covers it
+ * once through the work-stealing deques. res->st merges all cores; the
+ * per-core IOPS go to per_core if non-NULL.
+ */
+static int run_cores_job(int fd, size_t size, const uint8_t *pat_img, const JobSpec *spec,
+                         int ncores, const int *cpus, JobResult *res, double *per_core) {
+    CoreJob job = { .spec = spec, .fd = fd, .size = size, .pat_img = pat_img, .ncores = ncores,
+                    .link = rw_is_write(spec->rw) ? spec->link : LINK_NONE,
+                    .nbuf = rw_is_write(spec->rw) ? 0 : spec->buf_ring };
+    job.vj.spec    = spec;
+    job.vj.pat_img = pat_img;
+    atomic_init(&job.vj.mismatches, 0);
+    atomic_init(&job.vj.stop, 0);
+    atomic_init(&job.active, ncores);
+    atomic_init(&job.ready, 0);
+    atomic_init(&job.go, 0);
+
+    memset(res, 0, sizeof(*res));
+    res->spec        = *spec;
+    res->spec.link     = job.link;
+    res->spec.buf_ring = job.nbuf;
+    res->spec.verify   = spec->verify || job.link == LINK_READ;
+    res->cores         = ncores;
+    snprintf(res->label, sizeof(res->label), "%s", spec->name);
+    stats_init(&res->st);
+
+    uint64_t total = size / spec->bs;
+    if (spec->runtime > 0 && total < (uint64_t)ncores) {
+        /* Slices are disjoint so cores never race on a block */
+        fprintf(stderr, "Size %zu too small for %d slice(s) of %zu-byte blocks\n",
+                size, ncores, spec->bs);
+        return -1;
+    }
+    uint64_t nunits = 0;
+    if (spec->runtime <= 0) {
+        size_t unit      = spec->steal_unit > spec->bs ? spec->steal_unit : spec->bs;
+        job.unit_blocks  = unit / spec->bs;
+        job.nblocks      = (size + spec->bs - 1) / spec->bs;
+        nunits           = (job.nblocks + job.unit_blocks - 1) / job.unit_blocks;
+        job.deques       = aligned_alloc(CACHE_LINE, (size_t)ncores * sizeof(Deque));
+        if (!job.deques) {
+            perror("aligned_alloc (deques)");
+            return -1;
+        }
+        for (int i = 0; i < ncores; i++)
+            atomic_init(&job.deques[i].units,
+                        DEQUE(nunits * (uint64_t)i / (uint64_t)ncores,
+                              nunits * (uint64_t)(i + 1) / (uint64_t)ncores));
+    }
+
+    Core *cores = aligned_alloc(CACHE_LINE, (size_t)ncores * sizeof(Core));
+    if (!cores) {
+        perror("aligned_alloc (cores)");
+        free(job.deques);
+        return -1;
+    }
+    memset(cores, 0, (size_t)ncores * sizeof(Core));
+    int started = 0;
+    for (int i = 0; i < ncores; i++) {
+        Core *c    = &cores[i];
+        uint64_t a = total * (uint64_t)i / (uint64_t)ncores;
+        uint64_t b = total * (uint64_t)(i + 1) / (uint64_t)ncores;
+        stats_init(&c->st);
+        c->job     = &job;
+        c->id      = i;
+        c->cpu     = cpus ? cpus[i] : -1;
+        c->lo      = a * spec->bs;
+        c->nblocks = b - a;
+        c->rng     = 0x9E3779B97F4A7C15ull * (uint64_t)(i + 1) ^ (uint64_t)get_time_ns();
+        int e = pthread_create(&c->tid, NULL, core_main, c);
+        if (e != 0) {
+            fprintf(stderr, "pthread_create (core): %s\n", strerror(e));
+            atomic_store(&job.vj.stop, 1);
+            break;
+        }
+        started++;
+    }
+    atomic_fetch_sub(&job.active, ncores - started);
+    while (atomic_load(&job.ready) < started) usleep(50);
+    /* A core that could not set up fails the job before any core issues I/O */
+    int failed = started < ncores;
+    for (int i = 0; i < started; i++) {
+        if (cores[i].err) {
+            fprintf(stderr, "core %d: %s: %s\n", i, cores[i].what, strerror(cores[i].err));
+            failed = 1;
+        }
+    }
+    if (failed) atomic_store(&job.vj.stop, 1);
+    atomic_store(&job.go, 1);
+    if (failed) {
+        /* The started cores see the stop flag, free their rings and exit */
+        for (int i = 0; i < started; i++) pthread_join(cores[i].tid, NULL);
+        free(job.deques);
+        free(cores);
+        return -1;
+    }
+    double t_start = get_time_sec();
+    while (atomic_load(&job.active) > 0) {
+        if (spec->runtime > 0 && get_time_sec() - t_start >= spec->runtime) break;
+        usleep(10000);
+        if (spec->progress) {
+            uint64_t done = 0;
+            for (int i = 0; i < ncores; i++)
+                done += STAT_GET(cores[i].st.bytes) + STAT_GET(cores[i].unwritten);
+            print_progress(spec->progress, done, size);
+        }
+    }
+    atomic_store(&job.vj.stop, 1);
+
+    for (int i = 0; i < ncores; i++) {
+        pthread_join(cores[i].tid, NULL);
+        stats_merge(&res->st, &cores[i].st);
+        res->unwritten += cores[i].unwritten;
+        if (cores[i].err) {
+            fprintf(stderr, "\ncore %d: %s: %s\n", i, cores[i].what, strerror(cores[i].err));
+            failed = 1;
+        }
+    }
+    res->elapsed    = get_time_sec() - t_start;
+    res->iops       = res->st.ops / res->elapsed;
+    res->mbps       = ((double)res->st.bytes / MB) / res->elapsed;
+    res->mismatches = atomic_load(&job.vj.mismatches);
+    if (res->mismatches > MAX_MISMATCH && !spec->keep_going) res->mismatches = MAX_MISMATCH;
+    if (spec->progress) print_progress(spec->progress, res->st.bytes + res->unwritten, size);
+    for (int i = 0; per_core && i < ncores; i++)
+        per_core[i] = cores[i].st.ops / res->elapsed;
+    if (job.deques && !failed) {
+        uint64_t stolen = 0;
+        printf("\n[STEAL] %llu unit(s) of %zu bytes over %d core(s):", (unsigned long long)nunits,
+               (size_t)(job.unit_blocks * spec->bs), ncores);
+        for (int i = 0; i < ncores; i++) {
+            printf(" %llu", (unsigned long long)cores[i].units);
+            stolen += cores[i].stolen;
+        }
+        printf(", %llu stolen\n", (unsigned long long)stolen);
+    }
+    if (job.nbuf && !failed) {
+        uint64_t starved = 0;
+        for (int i = 0; i < ncores; i++) starved += cores[i].starved;
+        printf("\n[BUFRING] %d x %zu-byte buffer(s) per core: %.2f MB in all vs %.2f MB "
+               "with one per I/O in flight, %llu ENOBUFS requeue(s)\n",
+               job.nbuf, spec->bs, (double)job.nbuf * spec->bs * ncores / MB,
+               (double)spec->qd * spec->bs * ncores / MB, (unsigned long long)starved);
+    }
+    if (spec->slo)
+        res->slo_miss = slo_check(spec->slo, res->iops, res->mbps,
+                                  hist_percentile(&res->st.lat, 99.0) / 1e3,
+                                  hist_percentile(&res->st.lat, 99.9) / 1e3,
+                                  hist_stddev(&res->st.lat) / 1e3,
+                                  res->slo_why, sizeof(res->slo_why));
+    free(job.deques);
+    free(cores);
+    return failed ? -1 : 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* Reports                                                             */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    size_t bs;
+    int    qd;
+    int    phase;   /* index into Report.phases */
+} Knee;
+
+/* Steady-state window over per-round IOPS, see steady_check() */
+typedef struct {
+    int    reached;
+    int    rounds;     /* rounds run */
+    int    window;     /* rounds per window */
+    int    first;      /* first round of the last window evaluated, 1-based */
+    double avg;        /* window mean IOPS */
+    double range;      /* (max - min) / avg */
+    double excursion;  /* |fitted slope| * (window - 1) / avg */
+} SteadyState;
+
+typedef struct {
+    const char *filename;
+    size_t      size;
+    const char *mode;
+    uint64_t    pattern;
+    JobResult  *phases;
+    int         nphases;
+    int         cap;
+    Knee        knees[MAX_SWEEP];
+    int         nknees;
+    ErrorMap   *errors;
+    const ScanLog *scan;
+    const SteadyState *steady;
+    const Tuner *tune;
+    int         tune_best;     /* depth chosen by run_tune(), 0 = none met the target */
+    const Slo  *slo;
+    int         repeat;        /* --repeat runs, phases tagged with JobResult.run */
+    int         have_dev;      /* --device-stats: dev/host_written cover the whole run */
+    DevCounters dev;
+    uint64_t    host_written;
+} Report;
+
+static void report_init(Report *rep, const char *filename, size_t size,
+                        const char *mode, uint64_t pattern) {
+    memset(rep, 0, sizeof(*rep));
+    rep->filename = filename;
+    rep->size     = size;
+    rep->mode     = mode;
+    rep->pattern  = pattern;
+}
+
+/* Take ownership of res (including its interval samples) */
+static void report_add(Report *rep, const JobResult *res) {
+    if (rep->nphases == rep->cap) {
+        rep->cap    = rep->cap ? rep->cap * 2 : 8;
+        rep->phases = realloc(rep->phases, (size_t)rep->cap * sizeof(JobResult));
+        if (!rep->phases) {
+            perror("realloc (report)");
+            exit(EXIT_FAILURE);
+        }
+    }
+    rep->phases[rep->nphases++] = *res;
+}
+
+/* Per-core engine: the single-core phase of the same run r scales against */
+static const JobResult *scaling_base(const Report *rep, const JobResult *r) {
+    for (int i = 0; r->cores && i < rep->nphases; i++) {
+        const JobResult *p = &rep->phases[i];
+        if (p->cores == 1 && p->run == r->run && p->spec.rw == r->spec.rw &&
+            p->spec.bs == r->spec.bs && p->spec.qd == r->spec.qd && p->iops > 0)
+            return p;
+    }
+    return NULL;
+}
+
+static void report_free(Report *rep) {
+    for (int i = 0; i < rep->nphases; i++)
+        result_free(&rep->phases[i]);
+    free(rep->phases);
+}
+
+/*
+ * --repeat: the same phase (label, rw, bs, qd) of every run is one sample.
+ * The 95% confidence interval of the mean uses Student's t, since a handful
+ * of runs is far from enough for the normal approximation.
+ */
+typedef struct {
+    int    n;
+    double mean, stddev, min, max, ci95;
+} Summary;
+
+static const char *repeat_metrics[] = { "mbps", "iops", "p50_us", "p99_us", "p999_us" };
+#define NREPEAT_METRICS 5
+
+static double phase_metric(const JobResult *r, int m) {
+    switch (m) {
+    case 0:  return r->mbps;
+    case 1:  return r->iops;
+    case 2:  return hist_percentile(&r->st.lat, 50.0) / 1e3;
+    case 3:  return hist_percentile(&r->st.lat, 99.0) / 1e3;
+    default: return hist_percentile(&r->st.lat, 99.9) / 1e3;
+    }
+}
+
+/* Two-sided 97.5% quantile of Student's t with df degrees of freedom */
+static double t975(int df) {
+    static const double t[] = { 0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+                                2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110,
+                                2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056,
+                                2.052, 2.048, 2.045, 2.042 };
+    return df < 1 ? 0.0 : df <= 30 ? t[df] : df <= 60 ? 2.000 : 1.960;
+}
+
+static int same_phase(const JobResult *a, const JobResult *b) {
+    return strcmp(a->label, b->label) == 0 && a->spec.rw == b->spec.rw &&
+           a->spec.bs == b->spec.bs && a->spec.qd == b->spec.qd;
+}
+
+/* Summarize metric m over every run of the phase like rep->phases[p] */
+static void repeat_summary(const Report *rep, int p, int m, Summary *s) {
+    double sum = 0, sq = 0;
+    memset(s, 0, sizeof(*s));
+    for (int i = 0; i < rep->nphases; i++) {
+        if (!same_phase(&rep->phases[i], &rep->phases[p])) continue;
+        double v = phase_metric(&rep->phases[i], m);
+        if (s->n == 0 || v < s->min) s->min = v;
+        if (s->n == 0 || v > s->max) s->max = v;
+        sum += v;
+        s->n++;
+    }
+    if (s->n == 0) return;
+    s->mean = sum / s->n;
+    for (int i = 0; i < rep->nphases; i++)
+        if (same_phase(&rep->phases[i], &rep->phases[p])) {
+            double d = phase_metric(&rep->phases[i], m) - s->mean;
+            sq += d * d;
+        }
+    s->stddev = s->n > 1 ? sqrt(sq / (s->n - 1)) : 0.0;
+    s->ci95   = t975(s->n - 1) * s->stddev / sqrt(s->n);
+}
+
+static void json_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fprintf(f, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20) fprintf(f, "\\u%04x", *s);
+        else fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static void report_text(FILE *f, const Report *rep) {
+    fprintf(f, "%-10s %-10s %8s %5s %9s %12s %10s %9s %9s %9s %9s %9s %9s\n",
+            "phase", "rw", "bs", "qd", "sec", "IOPS", "MB/s", "mean_us",
+            "stdev_us", "p50_us", "p99_us", "p99.9_us", "max_us");
+    for (int i = 0; i < rep->nphases; i++) {
+        const JobResult *r = &rep->phases[i];
+        const LatHist   *h = &r->st.lat;
+        fprintf(f, "%-10s %-10s %8zu %5d %9.3f %12.0f %10.2f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+                r->label, rw_names[r->spec.rw], r->spec.bs, r->spec.qd, r->elapsed,
+                r->iops, r->mbps, hist_mean(h) / 1e3, hist_stddev(h) / 1e3,
+                hist_percentile(h, 50.0) / 1e3, hist_percentile(h, 99.0) / 1e3,
+                hist_percentile(h, 99.9) / 1e3, h->count ? h->max_ns / 1e3 : 0.0);
+    }
+    if (rep->have_dev && rep->dev.valid)
+        fprintf(f, "device: host %llu bytes, device %llu bytes, nand %llu bytes, wa %.3f\n",
+                (unsigned long long)rep->host_written,
+                (unsigned long long)device_host_written(&rep->dev),
+                (unsigned long long)rep->dev.media_written, device_wa(&rep->dev));
+    for (int i = 0; i < rep->nknees; i++)
+        fprintf(f, "knee: bs=%zu qd=%d\n", rep->knees[i].bs, rep->knees[i].qd);
+    for (int i = 0; i < rep->nphases; i++) {
+        const JobResult *r = &rep->phases[i], *one = scaling_base(rep, r);
+        if (r->cores && one)
+            fprintf(f, "scaling: cores=%d iops=%.0f per_core=%.0f speedup=%.2f efficiency=%.1f%%\n",
+                    r->cores, r->iops, r->iops / r->cores, r->iops / one->iops,
+                    100.0 * r->iops / one->iops / r->cores);
+    }
+    for (int i = 0; rep->repeat && i < rep->nphases; i++) {
+        if (rep->phases[i].run != 1) continue;
+        for (int m = 0; m < NREPEAT_METRICS; m++) {
+            Summary s;
+            repeat_summary(rep, i, m, &s);
+            fprintf(f, "repeat: %s %s n=%d mean %.2f stddev %.2f min %.2f max %.2f ci95 %.2f\n",
+                    rep->phases[i].label, repeat_metrics[m], s.n, s.mean, s.stddev, s.min,
+                    s.max, s.ci95);
+        }
+    }
+    if (rep->tune) {
+        int d = rep->tune_best;
+        if (d)
+            fprintf(f, "tune: depth %d, %.0f IOPS, p99 %.1f us (target %.0f us)\n", d,
+                    rep->tune->iops[d] / rep->tune->n[d], rep->tune->p99[d] / rep->tune->n[d],
+                    rep->tune->target_us);
+        else
+            fprintf(f, "tune: no depth met p99 <= %.0f us\n", rep->tune->target_us);
+    }
+    if (rep->steady) {
+        const SteadyState *s = rep->steady;
+        fprintf(f, "steady: %s, rounds %d-%d of %d, avg %.0f IOPS, range %.1f%%, excursion %.1f%%\n",
+                s->reached ? "reached" : "not reached", s->first, s->first + s->window - 1,
+                s->rounds, s->avg, 100.0 * s->range, 100.0 * s->excursion);
+    }
+}
+
+/* One row per phase (kind=phase) followed by its intervals (kind=interval) */
+static void report_csv(FILE *f, const Report *rep) {
+    fprintf(f, "kind,phase,rw,bs,qd,rate,time_s,ops,bytes,iops,mbps,"
+               "mean_us,stddev_us,min_us,p50_us,p90_us,p99_us,p999_us,max_us,late_pct,"
+               "dev_write_bytes,nand_write_bytes,wa\n");
+    for (int i = 0; i < rep->nphases; i++) {
+        const JobResult *r = &rep->phases[i];
+        const LatHist   *h = &r->st.lat;
+        fprintf(f, "phase,%s,%s,%zu,%d,%.0f,%.3f,%llu,%llu,%.0f,%.2f,"
+                   "%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.2f,",
+                r->label, rw_names[r->spec.rw], r->spec.bs, r->spec.qd, r->spec.rate,
+                r->elapsed, (unsigned long long)r->st.ops, (unsigned long long)r->st.bytes,
+                r->iops, r->mbps, hist_mean(h) / 1e3, hist_stddev(h) / 1e3,
+                h->count ? h->min_ns / 1e3 : 0.0, hist_percentile(h, 50.0) / 1e3,
+                hist_percentile(h, 90.0) / 1e3, hist_percentile(h, 99.0) / 1e3,
+                hist_percentile(h, 99.9) / 1e3, h->count ? h->max_ns / 1e3 : 0.0,
+                r->st.ops ? 100.0 * (double)r->st.late / (double)r->st.ops : 0.0);
+        if (r->dev.valid || r->dev.smart)
+            fprintf(f, "%llu,", (unsigned long long)device_host_written(&r->dev));
+        else
+            fprintf(f, ",");
+        if (r->dev.media)
+            fprintf(f, "%llu,%.3f\n", (unsigned long long)r->dev.media_written, device_wa(&r->dev));
+        else
+            fprintf(f, ",\n");
+        for (int j = 0; j < r->niv; j++) {
+            const IntervalSample *s = &r->iv[j];
+            fprintf(f, "interval,%s,%s,%zu,%d,%.0f,%.3f,,,%.0f,%.2f,%.1f,%.1f,,%.1f,,%.1f,%.1f,%.1f,,,,\n",
+                    r->label, rw_names[r->spec.rw], r->spec.bs, r->spec.qd, r->spec.rate,
+                    s->t, s->iops, s->mbps, s->mean_us, s->stddev_us, s->p50_us, s->p99_us,
+                    s->p999_us, s->max_us);
+        }
+    }
+}
+
+static void json_device(FILE *f, const DevCounters *c) {
+    fprintf(f, "{\"block_bytes_written\": %llu, \"block_bytes_read\": %llu, "
+               "\"requests\": %llu, \"merges\": %llu, \"io_ticks_ms\": %llu",
+            (unsigned long long)c->sectors_written * 512,
+            (unsigned long long)c->sectors_read * 512,
+            (unsigned long long)(c->reads + c->writes),
+            (unsigned long long)(c->read_merges + c->write_merges),
+            (unsigned long long)c->io_ticks);
+    if (c->smart)
+        fprintf(f, ", \"nvme_bytes_written\": %llu",
+                (unsigned long long)c->data_units_written * 512000);
+    if (c->media)
+        fprintf(f, ", \"media_bytes_written\": %llu, \"wa\": %.4f",
+                (unsigned long long)c->media_written, device_wa(c));
+    fprintf(f, "}");
+}
+
+static void report_json(FILE *f, const Report *rep) {
+    fprintf(f, "{\n  \"tool\": \"snb_dit\",\n  \"file\": ");
+    json_string(f, rep->filename);
+    fprintf(f, ",\n  \"size\": %zu,\n  \"mode\": ", rep->size);
+    json_string(f, rep->mode);
+    fprintf(f, ",\n  \"pattern\": \"0x%llX\",\n  \"phases\": [",
+            (unsigned long long)rep->pattern);
+    for (int i = 0; i < rep->nphases; i++) {
+        const JobResult *r = &rep->phases[i];
+        const LatHist   *h = &r->st.lat;
+        fprintf(f, "%s\n    {\"name\": ", i ? "," : "");
+        json_string(f, r->label);
+        if (r->run) fprintf(f, ", \"run\": %d", r->run);
+        if (r->cores) {
+            const JobResult *one = scaling_base(rep, r);
+            fprintf(f, ", \"cores\": %d", r->cores);
+            if (one)
+                fprintf(f, ", \"speedup\": %.3f, \"efficiency\": %.4f", r->iops / one->iops,
+                        r->iops / one->iops / r->cores);
+        }
+        if (r->spec.link) fprintf(f, ", \"link\": \"%s\"", link_names[r->spec.link]);
+        if (r->spec.buf_ring) fprintf(f, ", \"buf_ring\": %d", r->spec.buf_ring);
+        fprintf(f, ", \"rw\": \"%s\", \"bs\": %zu, \"qd\": %d, \"rate\": %.0f,\n",
+                rw_names[r->spec.rw], r->spec.bs, r->spec.qd, r->spec.rate);
+        if (r->spec.slow_ns)
+            fprintf(f, "     \"slow\": {\"threshold_us\": %.1f, \"count\": %llu},\n",
+                    r->spec.slow_ns / 1e3, (unsigned long long)r->slow);
+        fprintf(f, "     \"elapsed_s\": %.6f, \"ops\": %llu, \"bytes\": %llu, "
+                   "\"iops\": %.2f, \"mbps\": %.3f, \"late\": %llu,\n",
+                r->elapsed, (unsigned long long)r->st.ops, (unsigned long long)r->st.bytes,
+                r->iops, r->mbps, (unsigned long long)r->st.late);
+        fprintf(f, "     \"lat_us\": {\"mean\": %.3f, \"stddev\": %.3f, \"min\": %.3f, "
+                   "\"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"p99.9\": %.3f, \"max\": %.3f}",
+                hist_mean(h) / 1e3, hist_stddev(h) / 1e3, h->count ? h->min_ns / 1e3 : 0.0,
+                hist_percentile(h, 50.0) / 1e3, hist_percentile(h, 90.0) / 1e3,
+                hist_percentile(h, 99.0) / 1e3, hist_percentile(h, 99.9) / 1e3,
+                h->count ? h->max_ns / 1e3 : 0.0);
+        if (r->spec.meminfo)
+            fprintf(f, ",\n     \"page_cache\": {\"io\": \"%s\", \"peak_bytes\": %lld, "
+                       "\"after_bytes\": %lld}", cache_names[r->spec.cache],
+                    (long long)r->cache_peak, (long long)r->cache_after);
+        if (r->spec.verify)
+            fprintf(f, ",\n     \"verify\": {\"result\": \"%s\", \"mismatches\": %llu}",
+                    r->mismatches ? "FAILED" : "PASSED", (unsigned long long)r->mismatches);
+        if (r->spec.slo) {
+            fprintf(f, ",\n     \"slo\": {\"result\": \"%s\", \"failed_intervals\": %d, \"missed\": ",
+                    r->slo_miss || r->slo_iv ? "FAILED" : "PASSED", r->slo_iv);
+            json_string(f, r->slo_why);
+            fprintf(f, "}");
+        }
+        if (r->dev.valid || r->dev.smart) {
+            fprintf(f, ",\n     \"device\": ");
+            json_device(f, &r->dev);
+        }
+        if (r->reg) {
+            static const char *metric[] = { "mbps", "mean_us", "p50_us", "p99_us", "max_us" };
+            fprintf(f, ",\n     \"regions\": {\"count\": %d, \"region_bytes\": %llu",
+                    r->spec.regions, (unsigned long long)r->region_size);
+            for (int m = 0; m < 5; m++) {
+                fprintf(f, ",\n       \"%s\": [", metric[m]);
+                for (int k = 0; k < r->spec.regions; k++) {
+                    const RegionStats *g = &r->reg[k];
+                    double v = m == 0 ? region_mbps(g, r->spec.qd) :
+                               m == 1 ? region_mean_us(g) :
+                               m == 2 ? region_percentile(g, 50.0) / 1e3 :
+                               m == 3 ? region_percentile(g, 99.0) / 1e3 : g->lat_max_ns / 1e3;
+                    fprintf(f, "%s%.2f", k ? ", " : "", v);
+                }
+                fprintf(f, "]");
+            }
+            fprintf(f, "}");
+        }
+        if (r->niv) {
+            fprintf(f, ",\n     \"intervals\": [");
+            for (int j = 0; j < r->niv; j++) {
+                const IntervalSample *s = &r->iv[j];
+                fprintf(f, "%s\n       {\"t\": %.3f, \"iops\": %.2f, \"mbps\": %.3f, "
+                           "\"mean_us\": %.3f, \"stddev_us\": %.3f, \"p50_us\": %.3f, "
+                           "\"p99_us\": %.3f, \"p999_us\": %.3f, \"max_us\": %.3f",
+                        j ? "," : "", s->t, s->iops, s->mbps, s->mean_us, s->stddev_us,
+                        s->p50_us, s->p99_us, s->p999_us, s->max_us);
+                if (r->spec.slo)
+                    fprintf(f, ", \"slo_missed\": %d", s->slo_miss);
+                if (s->kvalid)
+                    fprintf(f, ",\n        \"kernel\": {\"iops\": %.2f, \"mbps\": %.3f, "
+                               "\"aqu_sz\": %.3f, \"util_pct\": %.2f, \"merges\": %llu, "
+                               "\"in_flight\": %llu}",
+                            s->k_iops, s->k_mbps, s->k_qd, s->k_util,
+                            (unsigned long long)s->k_merges, (unsigned long long)s->k_inflight);
+                fprintf(f, "}");
+            }
+            fprintf(f, "\n     ]");
+        }
+        fprintf(f, "}");
+    }
+    fprintf(f, "\n  ],\n  \"knees\": [");
+    for (int i = 0; i < rep->nknees; i++)
+        fprintf(f, "%s{\"bs\": %zu, \"qd\": %d}", i ? ", " : "",
+                rep->knees[i].bs, rep->knees[i].qd);
+    fprintf(f, "]");
+    if (rep->scan) {
+        const ScanLog *s = rep->scan;
+        fprintf(f, ",\n  \"scan\": {\"sector\": %zu, \"classes\": [", s->sector);
+        for (int c = 0; c <= s->nclasses; c++) {
+            if (c < s->nclasses)
+                fprintf(f, "%s{\"below_ms\": %.3f, ", c ? ", " : "", s->class_ns[c] / 1e6);
+            else
+                fprintf(f, ", {\"above_ms\": %.3f, ", s->class_ns[c - 1] / 1e6);
+            fprintf(f, "\"sectors\": %llu}", (unsigned long long)s->sectors[c]);
+        }
+        fprintf(f, ", {\"error\": true, \"sectors\": %llu}],\n    \"slow_ranges\": [",
+                (unsigned long long)s->sectors[s->nclasses + 1]);
+        for (int i = 0; i < s->nranges; i++)
+            fprintf(f, "%s\n      {\"start\": %llu, \"end\": %llu, \"max_ms\": %.3f, \"class\": %d}",
+                    i ? "," : "", (unsigned long long)s->ranges[i].start,
+                    (unsigned long long)s->ranges[i].end, s->ranges[i].max_ns / 1e6,
+                    s->ranges[i].cls);
+        fprintf(f, "%s]}", s->nranges ? "\n  " : "");
+    }
+    if (rep->repeat) {
+        int n = 0;
+        fprintf(f, ",\n  \"repeat\": {\"runs\": %d, \"phases\": [", rep->repeat);
+        for (int i = 0; i < rep->nphases; i++) {
+            if (rep->phases[i].run != 1) continue;
+            fprintf(f, "%s\n    {\"name\": ", n++ ? "," : "");
+            json_string(f, rep->phases[i].label);
+            fprintf(f, ", \"bs\": %zu, \"qd\": %d", rep->phases[i].spec.bs, rep->phases[i].spec.qd);
+            for (int m = 0; m < NREPEAT_METRICS; m++) {
+                Summary s;
+                repeat_summary(rep, i, m, &s);
+                fprintf(f, ",\n     \"%s\": {\"n\": %d, \"mean\": %.3f, \"stddev\": %.3f, "
+                           "\"min\": %.3f, \"max\": %.3f, \"ci95\": %.3f}",
+                        repeat_metrics[m], s.n, s.mean, s.stddev, s.min, s.max, s.ci95);
+            }
+            fprintf(f, "}");
+        }
+        fprintf(f, "\n  ]}");
+    }
+    if (rep->slo) {
+        int failed = 0;
+        for (int i = 0; i < rep->nphases; i++)
+            if (rep->phases[i].spec.slo && (rep->phases[i].slo_miss || rep->phases[i].slo_iv))
+                failed++;
+        fprintf(f, ",\n  \"slo\": {\"result\": \"%s\", \"failed_phases\": %d, "
+                   "\"min_mbps\": %g, \"min_iops\": %g,\n    \"max_p99_us\": %g, "
+                   "\"max_p999_us\": %g, \"max_stddev_us\": %g}",
+                failed ? "FAILED" : "PASSED", failed, rep->slo->min_mbps, rep->slo->min_iops,
+                rep->slo->max_p99, rep->slo->max_p999, rep->slo->max_stddev);
+    }
+    if (rep->tune) {
+        const Tuner *t = rep->tune;
+        int          d = rep->tune_best, n = 0;
+        fprintf(f, ",\n  \"tune\": {\"target_p99_us\": %.1f, \"depth\": %d, \"iops\": %.2f, "
+                   "\"p99_us\": %.3f, \"depths\": [", t->target_us, d,
+                d ? t->iops[d] / t->n[d] : 0.0, d ? t->p99[d] / t->n[d] : 0.0);
+        for (int k = 1; k <= t->max_depth; k++)
+            if (t->n[k])
+                fprintf(f, "%s\n    {\"depth\": %d, \"intervals\": %d, \"within\": %d, "
+                           "\"iops\": %.2f, \"p99_us\": %.3f}", n++ ? "," : "", k, t->n[k],
+                        t->ok[k], t->iops[k] / t->n[k], t->p99[k] / t->n[k]);
+        fprintf(f, "\n  ]}");
+    }
+    if (rep->steady) {
+        const SteadyState *s = rep->steady;
+        fprintf(f, ",\n  \"steady_state\": {\"reached\": %s, \"rounds\": %d, "
+                   "\"window\": {\"first\": %d, \"last\": %d}, \"avg_iops\": %.2f,\n"
+                   "    \"range_pct\": %.3f, \"excursion_pct\": %.3f, "
+                   "\"max_range_pct\": %.0f, \"max_excursion_pct\": %.0f}",
+                s->reached ? "true" : "false", s->rounds, s->first, s->first + s->window - 1,
+                s->avg, 100.0 * s->range, 100.0 * s->excursion, 100.0 * SS_RANGE,
+                100.0 * SS_SLOPE);
+    }
+    if (rep->have_dev) {
+        fprintf(f, ",\n  \"device\": {\"host_bytes_written\": %llu, \"counters\": ",
+                (unsigned long long)rep->host_written);
+        json_device(f, &rep->dev);
+        fprintf(f, "}");
+    }
+    if (rep->errors) {
+        const ErrorMap *m = rep->errors;
+        fprintf(f, ",\n  \"errors\": {\"retries\": %llu, \"recovered\": %llu, "
+                   "\"failed_bytes\": %llu, \"ranges\": [",
+                (unsigned long long)atomic_load(&m->retried),
+                (unsigned long long)atomic_load(&m->recovered),
+                (unsigned long long)errmap_bytes(m));
+        for (int i = 0; i < m->nranges; i++)
+            fprintf(f, "%s\n    {\"op\": \"%s\", \"start\": %llu, \"end\": %llu, "
+                       "\"errno\": %d, \"error\": \"%s\"}",
+                    i ? "," : "", rw_names[m->ranges[i].rw],
+                    (unsigned long long)m->ranges[i].start, (unsigned long long)m->ranges[i].end,
+                    m->ranges[i].err, errmap_reason(m->ranges[i].err));
+        fprintf(f, "%s]}", m->nranges ? "\n  " : "");
+    }
+    fprintf(f, "\n}\n");
+}
+
+/* --heatmap: one row per phase and region */
+static int write_heatmap(const char *path, const Report *rep) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror("fopen (heatmap)");
+        return -1;
+    }
+    fprintf(f, "phase,rw,region,start,end,ops,bytes,mbps,mean_us,p50_us,p99_us,max_us\n");
+    for (int i = 0; i < rep->nphases; i++) {
+        const JobResult *r = &rep->phases[i];
+        for (int k = 0; r->reg && k < r->spec.regions; k++) {
+            const RegionStats *g   = &r->reg[k];
+            uint64_t           beg = k * r->region_size;
+            uint64_t           end = beg + r->region_size < rep->size ? beg + r->region_size
+                                                                     : rep->size;
+            fprintf(f, "%s,%s,%d,%llu,%llu,%llu,%llu,%.2f,%.1f,%.1f,%.1f,%.1f\n",
+                    r->label, rw_names[r->spec.rw], k, (unsigned long long)beg,
+                    (unsigned long long)end, (unsigned long long)g->ops,
+                    (unsigned long long)g->bytes, region_mbps(g, r->spec.qd),
+                    region_mean_us(g), region_percentile(g, 50.0) / 1e3,
+                    region_percentile(g, 99.0) / 1e3, g->lat_max_ns / 1e3);
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+/*
+ * Console heatmap: one character per region, darker = lower throughput
+ * relative to the best region, then the slowest region by mean latency.
+ */
+static void print_regions(const char *tag, const JobResult *r) {
+    if (!r->reg) return;
+    static const char shade[] = "@%#*+=-:. ";
+    double best = 0.0;
+    int    slow = -1;
+    for (int k = 0; k < r->spec.regions; k++) {
+        double v = region_mbps(&r->reg[k], r->spec.qd);
+        if (v > best) best = v;
+        if (r->reg[k].ops && (slow < 0 || region_mean_us(&r->reg[k]) > region_mean_us(&r->reg[slow])))
+            slow = k;
+    }
+    printf("[REGIONS] %s |", tag);
+    for (int k = 0; k < r->spec.regions; k++) {
+        double v = best > 0 ? region_mbps(&r->reg[k], r->spec.qd) / best : 0.0;
+        putchar(r->reg[k].ops ? shade[(int)(v * 9.0 + 0.5)] : '?');
+    }
+    printf("|\n");
+    if (slow >= 0)
+        printf("[REGIONS] %s slowest region %d @ %.2f MB: mean %.1f us, p99 %.1f us, %.2f MB/s "
+               "(best %.2f MB/s)\n", tag, slow, (double)(slow * r->region_size) / MB,
+               region_mean_us(&r->reg[slow]), region_percentile(&r->reg[slow], 99.0) / 1e3,
+               region_mbps(&r->reg[slow], r->spec.qd), best);
+}
+
+/* Page cache growth of a job run with spec.meminfo */
+static void print_page_cache(const char *tag, const JobResult *r) {
+    if (!r->spec.meminfo) return;
+    printf("[CACHE] %s (%s): page cache %+.2f MB at peak, %+.2f MB after\n", tag,
+           cache_names[r->spec.cache], (double)r->cache_peak / MB, (double)r->cache_after / MB);
+}
+
+/* Mean, spread and 95% CI of every phase over the --repeat runs */
+static void print_repeat(const Report *rep) {
+    printf("[REPEAT] %-12s %8s %5s %-8s %12s %10s %12s %12s %10s\n",
+           "phase", "bs", "qd", "metric", "mean", "stddev", "min", "max", "+/-95%");
+    for (int i = 0; i < rep->nphases; i++) {
+        if (rep->phases[i].run != 1) continue;
+        for (int m = 0; m < NREPEAT_METRICS; m++) {
+            Summary s;
+            repeat_summary(rep, i, m, &s);
+            const JobResult *r = &rep->phases[i];
+            if (m == 0)
+                printf("[REPEAT] %-12s %8zu %5d ", r->label, r->spec.bs, r->spec.qd);
+            else
+                printf("[REPEAT] %-12s %8s %5s ", "", "", "");
+            printf("%-8s %12.2f %10.2f %12.2f %12.2f %10.2f\n", repeat_metrics[m], s.mean,
+                   s.stddev, s.min, s.max, s.ci95);
+        }
+    }
+}
+
+/* Console summary of the error map at the end of a --on-error=continue run */
+static void print_error_map(const ErrorMap *m) {
+    printf("\n[ERRORS] %d failed range(s), %llu byte(s); %llu retr%s, %llu recovered\n",
+           m->nranges, (unsigned long long)errmap_bytes(m),
+           (unsigned long long)atomic_load(&m->retried),
+           atomic_load(&m->retried) == 1 ? "y" : "ies",
+           (unsigned long long)atomic_load(&m->recovered));
+    for (int i = 0; i < m->nranges; i++) {
+        const ErrRange *r = &m->ranges[i];
+        printf("  %-9s offset %llu - %llu (%llu bytes): %s\n", rw_names[r->rw],
+               (unsigned long long)r->start, (unsigned long long)r->end,
+               (unsigned long long)(r->end - r->start), errmap_reason(r->err));
+    }
+}
+
+/*
+ * Bad-block map for --badblocks-out, readable back by --skip: one
+ * "first_lba count reason" line per range of failed I/O, mismatched data
+ * or previously skipped sectors. LBAs use the error map's sector size.
+ */
+static int write_badblocks(const char *path, const ErrorMap *m, const SkipTree *skip) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        perror("fopen (badblocks)");
+        return -1;
+    }
+    uint64_t sec = m->isolate_bs;
+    int      n   = 0;
+    fprintf(f, "# snb_dit bad-block map\n# sector_size %llu\n# first_lba count reason\n",
+            (unsigned long long)sec);
+    for (int i = 0; i < m->nranges; i++) {
+        const ErrRange *r     = &m->ranges[i];
+        uint64_t        first = r->start / sec;
+        uint64_t        last  = (r->end + sec - 1) / sec;
+        fprintf(f, "%llu %llu %s: %s\n", (unsigned long long)first,
+                (unsigned long long)(last - first), rw_names[r->rw], errmap_reason(r->err));
+        n++;
+    }
+    for (int i = 0; skip && i < skip->n; i++) {
+        uint64_t first = skip->start[i] / sec;
+        uint64_t last  = (skip->end[i] + sec - 1) / sec;
+        fprintf(f, "%llu %llu skip-list\n", (unsigned long long)first,
+                (unsigned long long)(last - first));
+        n++;
+    }
+    fclose(f);
+    printf("[BADBLOCKS] %d range(s) written to %s\n", n, path);
+    return 0;
+}
+
+/* Write the report in the selected format to --output (or stdout) */
+static int report_write(const Report *rep, const Options *opt) {
+    FILE *f = stdout;
+    if (opt->output) {
+        f = fopen(opt->output, "w");
+        if (!f) {
+            perror("fopen (report)");
+            return -1;
+        }
+    } else {
+        printf("\n");
+    }
+    switch (opt->format) {
+    case FMT_TEXT: report_text(f, rep); break;
+    case FMT_CSV:  report_csv(f, rep);  break;
+    case FMT_JSON: report_json(f, rep); break;
+    }
+    if (f != stdout) {
+        fclose(f);
+        printf("[REPORT] %s report written to %s\n", format_names[opt->format], opt->output);
+    }
+    return 0;
+}
+
+/* ------------------------------------------------------------------ */
+/* Option parsing                                                      */
+/* ------------------------------------------------------------------ */
+
+static RwType parse_rw(const char *str) {
+    for (int i = 0; i < RW_USER_TYPES; i++)
+        if (strcmp(str, rw_names[i]) == 0) return (RwType)i;
+    fprintf(stderr, "Invalid rw type: %s (read|write|randread|randwrite)\n", str);
+    exit(EXIT_FAILURE);
+}
+
+/* Parse "hex,inv,walk,rand" into out[], return count */
+static int parse_pattern_list(const char *str, PatternKind *out, int max) {
+    char *copy = strdup(str);
+    int   n    = 0;
+    for (char *tok = strtok(copy, ","); tok; tok = strtok(NULL, ",")) {
+        int k;
+        for (k = 0; k < PAT_KINDS; k++)
+            if (strcmp(tok, pattern_names[k]) == 0) break;
+        if (k == PAT_KINDS) {
+            fprintf(stderr, "Invalid pattern: %s (hex|inv|walk|rand)\n", tok);
+            exit(EXIT_FAILURE);
+        }
+        if (n == max) {
+            fprintf(stderr, "Too many list entries (max %d): %s\n", max, str);
+            exit(EXIT_FAILURE);
+        }
+        out[n++] = (PatternKind)k;
+    }
+    free(copy);
+    return n;
+}
+
+static ReportFormat parse_format(const char *str) {
+    for (int i = 0; i < 3; i++)
+        if (strcmp(str, format_names[i]) == 0) return (ReportFormat)i;
+    fprintf(stderr, "Invalid format: %s (text|csv|json)\n", str);
+    exit(EXIT_FAILURE);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s <filename> <size> <mode> <hex_pattern> [options]\n"
+        "  filename    : target file path\n"
+        "  size        : number of bytes (e.g. 4096)\n"
+        "  mode        : read | write | readwrite | sweep | copy | burnin | scan | steady |\n"
+        "                tune | cores | cache\n"
+        "  hex_pattern : hex value e.g. 0xDEADBEEF\n"
+        "Workload options:\n"
+        "  --bs=LIST       block size(s); read/write use the first (default 4M),\n"
+        "                  sweep all of them (default 4k,16k,64k,256k)\n"
+        "  --qd=LIST       queue depth(s) = worker threads; read/write use the first\n"
+        "                  (default 1), sweep all of them (default 1,2,4,8,16,32)\n"
+        "  --rw=TYPE       sweep: read | write | randread | randwrite (default randread);\n"
+        "                  write/readwrite: randwrite makes the write phase random\n"
+        "  --runtime=SEC   sweep: seconds per point (default 5); random write phase:\n"
+        "                  run for SEC instead of size/bs random writes\n"
+        "  --bitmap=FILE   save the written-block map after writing; read mode\n"
+        "                  verifies only the blocks it marks as written\n"
+        "  --rate=IOPS     open-loop: issue at this fixed rate and measure latency\n"
+        "                  from the scheduled issue time (default closed-loop)\n"
+        "Copy options (chunk size = --bs, parallel copies = --qd):\n"
+        "  --dest=FILE     destination of the copy, verified after copying\n"
+        "Burn-in options:\n"
+        "  --passes=K      write+verify passes (default 4)\n"
+        "  --patterns=LIST pattern rotation from hex | inv | walk | rand\n"
+        "                  (default hex,inv,walk,rand)\n"
+        "Scan options (read-only, chunk size = --bs, hex_pattern unused):\n"
+        "  --classes=LIST  latency class bounds in ms (default 5,50,500); blocks\n"
+        "                  above the first are re-read per logical block\n"
+        "Steady-state options (SNIA PTS; round workload = --rw, first --bs and --qd,\n"
+        "  --runtime seconds per round):\n"
+        "  --precondition=N  sequential 128k write passes before the rounds (default 2)\n"
+        "  --rounds=N      give up after N rounds (default 25)\n"
+        "  --ss-window=N   rounds in the steady-state window (default 5)\n"
+        "Core scaling options (per-core io_uring; workload = --rw, first --bs,\n"
+        "  --qd = in flight per core, default 32; --runtime = seconds per step):\n"
+        "  --cores=LIST    core counts to run (default 1,2,4,... and all allowed CPUs);\n"
+        "                  read/write/readwrite: run the phases on the first count,\n"
+        "                  --qd in flight per core, work stealing between cores\n"
+        "  --steal-unit=SIZE  bytes per stealable work unit (default 4m)\n"
+        "  --link=OP       fsync | fdatasync | read: link every write to this op with\n"
+        "                  IOSQE_IO_LINK (read = read back and verify); latency is\n"
+        "                  per chain. Write phases and cores mode writes; implies --cores=1\n"
+        "  --buf-ring=N    reads take one of N buffers per core from an io_uring\n"
+        "                  provided buffer ring when issued, recycled as soon as\n"
+        "                  verified, instead of one buffer per I/O in flight. Read\n"
+        "                  phases and cores mode reads; implies --cores=1\n"
+        "Page cache options:\n"
+        "  --cache=MODE    read/write/readwrite through direct (O_DIRECT, default),\n"
+        "                  buffered, or dontcache (buffered with RWF_DONTCACHE: pages\n"
+        "                  dropped after writeback, Linux 6.14+); the page cache growth\n"
+        "                  is reported. cache mode runs all three, first --bs and --qd\n"
+        "Auto-tune options (workload = --rw and first --bs; --qd = maximum depth,\n"
+        "  default 64; --runtime = tuning time; --interval = step, default 0.5):\n"
+        "  --target-p99=USEC  p99 latency budget the depth search must respect\n"
+        "Performance thresholds (checked per phase and per --interval; exit status 3\n"
+        "  if any is missed, 2 on data mismatch, 1 on I/O errors):\n"
+        "  --min-mbps=X    minimum throughput\n"
+        "  --min-iops=X    minimum IOPS\n"
+        "  --max-p99=USEC  maximum 99th percentile latency\n"
+        "  --max-p999=USEC maximum 99.9th percentile latency\n"
+        "  --max-stddev=USEC  maximum latency standard deviation\n"
+        "Repetition:\n"
+        "  --repeat=N      run the mode N times and report mean, stddev, min/max and\n"
+        "                  95%% confidence interval of MB/s, IOPS and latency percentiles\n"
+        "  --drop-caches   sync and drop the page cache before every run after the first\n"
+        "  --cooldown=SEC  idle SEC seconds between runs\n"
+        "Error handling:\n"
+        "  --on-error=ACT  abort (default) | continue: record failed ranges and go on\n"
+        "  --retries=N     continue: retries of a failed I/O before isolating (default 3)\n"
+        "  --retry-delay=MS  continue: pause before each retry (default 10)\n"
+        "  --isolate-bs=SIZE continue: split failed I/Os down to this size\n"
+        "                  (default logical sector size, 512 for files)\n"
+        "  --badblocks-out=FILE  write failed/mismatched LBA ranges to FILE\n"
+        "  --skip=FILE     never touch the LBA ranges listed in FILE\n"
+        "                  (format of --badblocks-out)\n"
+        "Report options:\n"
+        "  --regions=N     split the range into N regions with their own throughput and\n"
+        "                  latency (console heatmap, JSON \"regions\")\n"
+        "  --heatmap=FILE  CSV of every phase x region (implies --regions=64)\n"
+        "  --clock=SRC     auto | tsc | raw timestamp source (default auto: invariant\n"
+        "                  TSC if it calibrates, else CLOCK_MONOTONIC_RAW)\n"
+        "  --slow=USEC     capture every I/O taking at least USEC (offset, length,\n"
+        "                  times, queue depth); dumped after each job and on SIGUSR1\n"
+        "  --slow-ring=N   captured I/Os kept per worker, oldest dropped (default 1024)\n"
+        "  --slow-out=FILE append the captured I/Os to FILE (default stdout)\n"
+        "  --trace=FILE    binary record of every I/O; read it with\n"
+        "                  %s decode FILE [CSV]\n"
+        "  --device-stats  sample diskstats and NVMe SMART / OCP logs around each phase\n"
+        "                  and report device bytes written and write amplification;\n"
+        "                  with --interval also the kernel's view of each interval\n"
+        "  --interval=SEC  print and record statistics every SEC seconds\n"
+        "  --format=FMT    text | csv | json summary report (default text)\n"
+        "  --output=FILE   write the report to FILE instead of stdout\n"
+        "  --csv=FILE      shorthand for --format=csv --output=FILE\n"
+        "Compare two JSON reports (exit 3 on a significant regression):\n"
+        "  %s compare BASE.json NEW.json [--threshold=PCT, default 5]\n",
+        prog, prog, prog);
+}
+
+static void parse_options(int argc, char *argv[], Options *opt) {
+    static const struct option long_opts[] = {
+        { "rw",       required_argument, NULL, 'r' },
+        { "qd",       required_argument, NULL, 'q' },
+        { "bs",       required_argument, NULL, 'b' },
+        { "runtime",  required_argument, NULL, 't' },
+        { "rate",     required_argument, NULL, 'R' },
+        { "interval", required_argument, NULL, 'i' },
+        { "dest",     required_argument, NULL, 'd' },
+        { "passes",   required_argument, NULL, 'P' },
+        { "patterns", required_argument, NULL, 'p' },
+        { "on-error", required_argument, NULL, 'E' },
+        { "retries",  required_argument, NULL, 'T' },
+        { "retry-delay", required_argument, NULL, 'D' },
+        { "isolate-bs",  required_argument, NULL, 'I' },
+        { "badblocks-out", required_argument, NULL, 'B' },
+        { "skip",     required_argument, NULL, 'S' },
+        { "bitmap",   required_argument, NULL, 'M' },
+        { "device-stats", no_argument,   NULL, 'V' },
+        { "slow",     required_argument, NULL, 'L' },
+        { "slow-ring", required_argument, NULL, 'N' },
+        { "slow-out", required_argument, NULL, 'O' },
+        { "trace",    required_argument, NULL, 'X' },
+        { "clock",    required_argument, NULL, 'K' },
+        { "regions",  required_argument, NULL, 'G' },
+        { "heatmap",  required_argument, NULL, 'H' },
+        { "classes",  required_argument, NULL, 'C' },
+        { "precondition", required_argument, NULL, 'W' },
+        { "rounds",   required_argument, NULL, 'U' },
+        { "ss-window", required_argument, NULL, 'Y' },
+        { "min-mbps", required_argument, NULL, 'A' },
+        { "min-iops", required_argument, NULL, 'F' },
+        { "max-p99",  required_argument, NULL, 'J' },
+        { "max-p999", required_argument, NULL, 'Q' },
+        { "max-stddev", required_argument, NULL, 'Z' },
+        { "repeat",   required_argument, NULL, 'e' },
+        { "target-p99", required_argument, NULL, 'k' },
+        { "cores",    required_argument, NULL, 'u' },
+        { "steal-unit", required_argument, NULL, 'v' },
+        { "link",     required_argument, NULL, 'l' },
+        { "buf-ring", required_argument, NULL, 'w' },
+        { "cache",    required_argument, NULL, 'a' },
+        { "drop-caches", no_argument,    NULL, 'g' },
+        { "cooldown", required_argument, NULL, 'j' },
+        { "format",   required_argument, NULL, 'f' },
+        { "output",   required_argument, NULL, 'o' },
+        { "csv",      required_argument, NULL, 'c' },
+        { "help",     no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    memset(opt, 0, sizeof(*opt));
+    opt->rw      = RW_RANDREAD;
+    opt->nbs     = parse_size_list("4k,16k,64k,256k", opt->bs_list, MAX_SWEEP);
+    opt->nqd     = parse_size_list("1,2,4,8,16,32", opt->qd_list, MAX_SWEEP);
+    opt->runtime = 5.0;
+    opt->passes  = 4;
+    opt->retries = 3;
+    opt->retry_delay_ms = 10;
+    opt->slow_ring = 1024;
+    opt->clock   = "auto";
+    opt->nclasses = 3;
+    opt->classes_ms[0] = 5;
+    opt->classes_ms[1] = 50;
+    opt->classes_ms[2] = 500;
+    opt->precondition = 2;
+    opt->rounds    = 25;
+    opt->ss_window = 5;
+    opt->repeat    = 1;
+    opt->steal_unit = CHUNK_SIZE;
+    opt->npatterns = parse_pattern_list("hex,inv,walk,rand", opt->patterns, MAX_SWEEP);
+    opt->format  = FMT_TEXT;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "h", long_opts, NULL)) != -1) {
+        switch (c) {
+        case 'r': opt->rw       = parse_rw(optarg); break;
+        case 'q': opt->nqd      = parse_size_list(optarg, opt->qd_list, MAX_SWEEP);
+                  opt->qd_set   = 1; break;
+        case 'b': opt->nbs      = parse_size_list(optarg, opt->bs_list, MAX_SWEEP);
+                  opt->bs_set   = 1; break;
+        case 't': opt->runtime  = atof(optarg);
+                  opt->runtime_set = 1; break;
+        case 'R': opt->rate     = atof(optarg); break;
+        case 'i': opt->interval = atof(optarg); break;
+        case 'd': opt->dest     = optarg; break;
+        case 'P': opt->passes   = atoi(optarg); break;
+        case 'p': opt->npatterns = parse_pattern_list(optarg, opt->patterns, MAX_SWEEP); break;
+        case 'E':
+            if (strcmp(optarg, "continue") == 0)   opt->on_error_continue = 1;
+            else if (strcmp(optarg, "abort") == 0) opt->on_error_continue = 0;
+            else {
+                fprintf(stderr, "Invalid --on-error: %s (abort|continue)\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'T': opt->retries        = atoi(optarg); break;
+        case 'D': opt->retry_delay_ms = atoi(optarg); break;
+        case 'I': opt->isolate_bs     = parse_size(optarg); break;
+        case 'B': opt->badblocks_out  = optarg; break;
+        case 'S': opt->skip_list      = optarg; break;
+        case 'M': opt->bitmap         = optarg; break;
+        case 'V': opt->device_stats   = 1; break;
+        case 'L': opt->slow_us        = atof(optarg); break;
+        case 'N': opt->slow_ring      = atoi(optarg); break;
+        case 'O': opt->slow_out       = optarg; break;
+        case 'X': opt->trace          = optarg; break;
+        case 'G': opt->regions        = atoi(optarg); break;
+        case 'H': opt->heatmap        = optarg; break;
+        case 'W': opt->precondition   = atoi(optarg); break;
+        case 'U': opt->rounds         = atoi(optarg); break;
+        case 'Y': opt->ss_window      = atoi(optarg); break;
+        case 'A': opt->slo.min_mbps   = atof(optarg); break;
+        case 'F': opt->slo.min_iops   = atof(optarg); break;
+        case 'J': opt->slo.max_p99    = atof(optarg); break;
+        case 'Q': opt->slo.max_p999   = atof(optarg); break;
+        case 'Z': opt->slo.max_stddev = atof(optarg); break;
+        case 'e': opt->repeat         = atoi(optarg); break;
+        case 'k': opt->target_p99     = atof(optarg); break;
+        case 'u': opt->ncores         = parse_size_list(optarg, opt->cores_list, MAX_SWEEP); break;
+        case 'v': opt->steal_unit     = parse_size(optarg); break;
+        case 'w': opt->buf_ring       = atoi(optarg); break;
+        case 'a': {
+            int k = CACHE_DIRECT;
+            while (k <= CACHE_DONTCACHE && strcmp(optarg, cache_names[k])) k++;
+            if (k > CACHE_DONTCACHE) {
+                fprintf(stderr, "Invalid --cache: %s (direct|buffered|dontcache)\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            opt->cache = (CacheMode)k;
+            break;
+        }
+        case 'l': {
+            int k = LINK_FSYNC;
+            while (k <= LINK_READ && strcmp(optarg, link_names[k])) k++;
+            if (k > LINK_READ) {
+                fprintf(stderr, "Invalid --link: %s (fsync|fdatasync|read)\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            opt->link = (LinkKind)k;
+            break;
+        }
+        case 'g': opt->drop_caches    = 1; break;
+        case 'j': opt->cooldown       = atof(optarg); break;
+        case 'C': {
+            char *s = optarg, *end;
+            opt->nclasses = 0;
+            while (*s && opt->nclasses < MAX_CLASSES) {
+                double v = strtod(s, &end);
+                if (end == s || v <= 0 ||
+                    (opt->nclasses && v <= opt->classes_ms[opt->nclasses - 1])) {
+                    fprintf(stderr, "Invalid --classes: %s (ascending ms values)\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                opt->classes_ms[opt->nclasses++] = v;
+                s = *end == ',' ? end + 1 : end;
+                if (*end && *end != ',') break;
+            }
+            break;
+        }
+        case 'K':
+            if (strcmp(optarg, "auto") && strcmp(optarg, "tsc") && strcmp(optarg, "raw")) {
+                fprintf(stderr, "Invalid --clock: %s (auto|tsc|raw)\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            opt->clock = optarg;
+            break;
+        case 'f': opt->format   = parse_format(optarg);
+                  opt->format_set = 1; break;
+        case 'o': opt->output   = optarg; break;
+        case 'c': opt->format   = FMT_CSV;
+                  opt->format_set = 1;
+                  opt->output   = optarg; break;
+        default:
+            usage(argv[0]);
+            exit(c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    for (int i = 0; i < opt->nbs; i++) {
+        if (opt->bs_list[i] == 0 || opt->bs_list[i] % ALIGNMENT != 0) {
+            fprintf(stderr, "Block size %zu must be a non-zero multiple of %d\n",
+                    opt->bs_list[i], ALIGNMENT);
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < opt->nqd; i++) {
+        if (opt->qd_list[i] < 1 || opt->qd_list[i] > MAX_QD) {
+            fprintf(stderr, "Queue depth %zu out of range (1..%d)\n", opt->qd_list[i], MAX_QD);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (opt->runtime <= 0) {
+        fprintf(stderr, "Runtime must be > 0 seconds\n");
+        exit(EXIT_FAILURE);
+    }
+    if (opt->rate < 0 || (opt->rate > 0 && 1e9 / opt->rate < 1.0)) {
+        fprintf(stderr, "Rate must be between 0 and 1e9 IOPS\n");
+        exit(EXIT_FAILURE);
+    }
+    if (opt->retries < 0 || opt->retry_delay_ms < 0) {
+        fprintf(stderr, "Retries and retry delay must be >= 0\n");
+        exit(EXIT_FAILURE);
+    }
+    if (opt->isolate_bs % ALIGNMENT != 0) {
+        fprintf(stderr, "Isolate size must be a multiple of %d\n", ALIGNMENT);
+        exit(EXIT_FAILURE);
+    }
+    if (opt->passes < 1) {
+        fprintf(stderr, "Passes must be >= 1\n");
+        exit(EXIT_FAILURE);
+    }
+    if (opt->slow_us < 0 || opt->slow_ring < 1) {
+        fprintf(stderr, "Slow threshold must be >= 0 and the slow ring >= 1\n");
+        exit(EXIT_FAILURE);
+    }
+    if (opt->precondition < 0 || opt->ss_window < 2 || opt->rounds < opt->ss_window) {
+        fprintf(stderr, "Need --precondition >= 0, --ss-window >= 2 and --rounds >= --ss-window\n");
+        exit(EXIT_FAILURE);
+    }
+    if (opt->slo.min_mbps < 0 || opt->slo.min_iops < 0 || opt->slo.max_p99 < 0 ||
+        opt->slo.max_p999 < 0 || opt->slo.max_stddev < 0) {
+        fprintf(stderr, "Performance thresholds must be >= 0\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < opt->ncores; i++) {
+        if (opt->cores_list[i] < 1 || opt->cores_list[i] > MAX_QD) {
+            fprintf(stderr, "Core count %zu out of range (1..%d)\n", opt->cores_list[i], MAX_QD);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (opt->buf_ring < 0 || opt->buf_ring > 32768) {
+        fprintf(stderr, "Buffer ring size %d out of range (1..32768)\n", opt->buf_ring);
+        exit(EXIT_FAILURE);
+    }
+    if (opt->steal_unit == 0 || opt->steal_unit > ((size_t)1 << 40)) {
+        fprintf(stderr, "Steal unit must be between 1 byte and 1 TB\n");
+        exit(EXIT_FAILURE);
+    }
+    if (opt->target_p99 < 0) {
+        fprintf(stderr, "Target p99 must be >= 0\n");
+        exit(EXIT_FAILURE);
+    }
+    if (opt->repeat < 1 || opt->cooldown < 0) {
+        fprintf(stderr, "Repeat must be >= 1 and cooldown >= 0 seconds\n");
+        exit(EXIT_FAILURE);
+    }
+    if (opt->heatmap && opt->regions == 0) opt->regions = 64;
+    if (opt->regions < 0 || opt->regions > 65536) {
+        fprintf(stderr, "Regions must be between 0 and 65536\n");
+        exit(EXIT_FAILURE);
+    }
+    if (opt->interval < 0) {
+        fprintf(stderr, "Interval must be >= 0 seconds\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* ------------------------------------------------------------------ */
+/* Sweep mode                                                          */
+/* ------------------------------------------------------------------ */
+
+/*
+ * The knee of a latency/throughput curve is where extra queue depth stops
+ * buying throughput and only adds latency. Use Kleinrock's power metric
+ * (throughput / mean latency), which peaks exactly at that point.
+ */
+static const JobResult *find_knee(const JobResult *pts, int n) {
+    const JobResult *best = NULL;
+    double best_power = 0.0;
+    for (int i = 0; i < n; i++) {
+        double mean = hist_mean(&pts[i].st.lat);
+        if (mean <= 0) continue;
+        double power = pts[i].iops / mean;
+        if (power > best_power) {
+            best_power = power;
+            best       = &pts[i];
+        }
+    }
+    return best;
+}
+
+/* Write the whole range once if a regular file is too short to read back */
+static int prefill_file(int fd, size_t size, const uint8_t *pat_img, size_t bs) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (size_t)st.st_size >= size)
+        return 0;
+
+    printf("Prefilling %.2f MB with pattern for reads...\n", (double)size / MB);
+    JobSpec   spec = { .name = "prefill", .rw = RW_WRITE, .bs = bs, .qd = 1 };
+    JobResult res;
+    return run_job(fd, size, pat_img, &spec, &res);
+}
+
+static int run_sweep(const char *filename, size_t size, const HexPattern *pat,
+                     const Options *opt, FILE *slow_out, Tracer *tracer, Report *rep) {
+    size_t max_bs = 0;
+    for (int i = 0; i < opt->nbs; i++) {
+        if (opt->bs_list[i] > size) {
+            fprintf(stderr, "Block size %zu larger than size %zu\n", opt->bs_list[i], size);
+            return EXIT_FAILURE;
+        }
+        if (opt->bs_list[i] > max_bs) max_bs = opt->bs_list[i];
+    }
+
+    int flags = rw_is_write(opt->rw) ? (O_RDWR | O_CREAT) : O_RDWR;
+    int fd    = open(filename, flags | O_DIRECT, 0644);
+    if (fd < 0 && !rw_is_write(opt->rw) && (errno == EACCES || errno == EROFS || errno == ENOENT))
+        fd = open(filename, O_RDONLY | O_DIRECT);
+    if (fd < 0) {
+        perror("open (sweep)");
+        return EXIT_FAILURE;
+    }
+
+    uint8_t *pat_img = build_pattern_image(pat, max_bs);
+    if (!rw_is_write(opt->rw) && prefill_file(fd, size, pat_img, CHUNK_SIZE < size ? CHUNK_SIZE : size) != 0) {
+        close(fd); free(pat_img);
+        return EXIT_FAILURE;
+    }
+
+    int rc    = EXIT_SUCCESS;
+    int knee0 = rep->nknees;
+
+    printf("[SWEEP] rw=%s, %d block size(s) x %d queue depth(s), %.1f sec per point\n\n",
+           rw_names[opt->rw], opt->nbs, opt->nqd, opt->runtime);
+    if (opt->rate > 0)
+        printf("[OPEN-LOOP] target %.0f IOPS, latency measured from scheduled issue time\n\n",
+               opt->rate);
+    printf("%-10s %8s %5s %12s %10s %10s %10s %10s%s\n",
+           "rw", "bs", "qd", "IOPS", "MB/s", "mean_us", "p50_us", "p99_us",
+           opt->rate > 0 ? "      late%" : "");
+
+    for (int b = 0; b < opt->nbs && rc == EXIT_SUCCESS; b++) {
+        int first = rep->nphases;
+        for (int q = 0; q < opt->nqd; q++) {
+            JobSpec   spec = { .name = "sweep", .rw = opt->rw, .bs = opt->bs_list[b],
+                               .qd = (int)opt->qd_list[q], .runtime = opt->runtime,
+                               .rate = opt->rate, .interval = opt->interval,
+                               .slow_ns = (uint64_t)(opt->slow_us * 1e3),
+                               .slow_ring = opt->slow_ring, .slow_out = slow_out,
+                               .trace = tracer, .regions = opt->regions,
+                               .slo = slo_active(&opt->slo) ? &opt->slo : NULL };
+            JobResult res;
+            if (run_job(fd, size, pat_img, &spec, &res) != 0) {
+                result_free(&res);
+                rc = EXIT_FAILURE;
+                break;
+            }
+
+            const LatHist *h = &res.st.lat;
+            printf("%-10s %8zu %5d %12.0f %10.2f %10.1f %10.1f %10.1f",
+                   rw_names[opt->rw], spec.bs, spec.qd, res.iops, res.mbps,
+                   hist_mean(h) / 1e3, hist_percentile(h, 50.0) / 1e3,
+                   hist_percentile(h, 99.0) / 1e3);
+            if (opt->rate > 0)
+                printf(" %10.2f", res.st.ops ? 100.0 * (double)res.st.late / (double)res.st.ops : 0.0);
+            printf("\n");
+            if (opt->rate > 0 && res.iops < 0.95 * opt->rate)
+                printf("  [OPEN-LOOP] target not sustained (max lag %.1f ms)\n",
+                       res.st.max_lag_ns / 1e6);
+            fflush(stdout);
+            report_add(rep, &res);
+        }
+        if (rc != EXIT_SUCCESS) break;
+
+        const JobResult *k = find_knee(&rep->phases[first], rep->nphases - first);
+        if (k && rep->nknees < MAX_SWEEP) {
+            Knee *knee  = &rep->knees[rep->nknees++];
+            knee->bs    = k->spec.bs;
+            knee->qd    = k->spec.qd;
+            knee->phase = (int)(k - rep->phases);
+        }
+    }
+
+    if (rc == EXIT_SUCCESS) {
+        printf("\n");
+        for (int i = knee0; i < rep->nknees; i++) {
+            const JobResult *k = &rep->phases[rep->knees[i].phase];
+            printf("[KNEE] bs=%zu: qd=%d => %.0f IOPS, %.2f MB/s, p99 %.1f us\n",
+                   k->spec.bs, k->spec.qd, k->iops, k->mbps,
+                   hist_percentile(&k->st.lat, 99.0) / 1e3);
+        }
+    }
+
+    free(pat_img);
+    close(fd);
+    return rc;
+}
+
+/* ------------------------------------------------------------------ */
+/* Write / read+verify phases                                          */
+/* ------------------------------------------------------------------ */
+
+/*
+ * A random write phase (base->rw == RW_RANDWRITE) keeps the existing file
+ * contents, so blocks recorded in base->written by earlier runs stay valid.
+ */
+static int run_write_phase(const char *filename, size_t size, const uint8_t *pat_img,
+                           const JobSpec *base, Report *rep) {
+    int random = base->rw == RW_RANDWRITE;
+    int fd     = open(filename, (base->link == LINK_READ || base->cache ? O_RDWR : O_WRONLY) |
+                      O_CREAT | (base->cache ? 0 : O_DIRECT) | (random ? 0 : O_TRUNC), 0644);
+    if (fd < 0) {
+        perror("open (write)");
+        return EXIT_FAILURE;
+    }
+    int dc = base->cache == CACHE_DONTCACHE ? dontcache_probe(fd) : 1;
+    if (dc <= 0) {
+        if (dc == 0)
+            fprintf(stderr, "RWF_DONTCACHE is not supported for %s (needs Linux 6.14+ "
+                            "and filesystem support)\n", filename);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    JobSpec spec  = *base;
+    spec.name     = "write";
+    spec.rw       = random ? RW_RANDWRITE : RW_WRITE;
+    spec.progress = "WRITE";
+
+    JobResult res;
+    int       err = run_job(fd, size, pat_img, &spec, &res);
+    close(fd);
+    if (err) {
+        result_free(&res);
+        return EXIT_FAILURE;
+    }
+
+    printf("\n[WRITE] Written %.2f MB in %.3f sec => %.2f MB/s\n",
+           (double)res.st.bytes / MB, res.elapsed, res.mbps);
+    if (res.spec.link) {
+        printf("[LINK]  %llu write->%s chain(s): p50 %.1f us, p99 %.1f us, max %.1f us\n",
+               (unsigned long long)res.st.ops, link_names[res.spec.link],
+               hist_percentile(&res.st.lat, 50.0) / 1e3, hist_percentile(&res.st.lat, 99.0) / 1e3,
+               res.st.lat.count ? res.st.lat.max_ns / 1e3 : 0.0);
+        if (res.spec.link == LINK_READ && res.mismatches == 0)
+            printf("[VERIFY] PASSED - All %.2f MB read back match the pattern!\n",
+                   (double)res.st.bytes / MB);
+        else if (res.spec.link == LINK_READ)
+            printf("[VERIFY] FAILED - %llu mismatch(es) found on read-back!\n",
+                   (unsigned long long)res.mismatches);
+    }
+    if (res.skipped)
+        printf("[WRITE] Skipped %llu byte(s) in known-bad ranges\n",
+               (unsigned long long)res.skipped);
+    if (spec.dev) print_device("write", res.st.bytes, &res.dev);
+    print_regions("write", &res);
+    print_page_cache("write", &res);
+    if (spec.written) {
+        spec.written->gen++;
+        printf("[WRITE] %llu of %llu block(s) written so far (generation %llu)\n",
+               (unsigned long long)blockmap_count(spec.written),
+               (unsigned long long)spec.written->nblocks,
+               (unsigned long long)spec.written->gen);
+    }
+    report_add(rep, &res);
+    return EXIT_SUCCESS;
+}
+
+static int run_read_phase(const char *filename, size_t size, const uint8_t *pat_img,
+                          const JobSpec *base, const char *name, Report *rep) {
+    int fd = open(filename, O_RDONLY | (base->cache ? 0 : O_DIRECT));
+    if (fd < 0) {
+        perror("open (read)");
+        return EXIT_FAILURE;
+    }
+    if (base->cache) {
+        int dc = base->cache == CACHE_DONTCACHE ? dontcache_probe(fd) : 1;
+        if (dc <= 0) {
+            if (dc == 0)
+                fprintf(stderr, "RWF_DONTCACHE is not supported for %s (needs Linux 6.14+ "
+                                "and filesystem support)\n", filename);
+            close(fd);
+            return EXIT_FAILURE;
+        }
+        page_cache_evict(fd);   /* read the device, not what the write left behind */
+    }
+
+    JobSpec spec  = *base;
+    spec.name     = name;
+    spec.rw       = RW_READ;
+    spec.runtime  = 0;
+    spec.verify   = 1;
+    spec.progress = "READ ";
+
+    JobResult res;
+    int       err = run_job(fd, size, pat_img, &spec, &res);
+    close(fd);
+    if (err) {
+        result_free(&res);
+        return EXIT_FAILURE;
+    }
+
+    printf("\n[READ]  Read %.2f MB in %.3f sec => %.2f MB/s\n",
+           (double)res.st.bytes / MB, res.elapsed, res.mbps);
+
+    if (res.skipped)
+        printf("[VERIFY] Skipped %llu byte(s) in known-bad ranges\n",
+               (unsigned long long)res.skipped);
+    if (res.unwritten)
+        printf("[VERIFY] Skipped %llu byte(s) never written\n",
+               (unsigned long long)res.unwritten);
+    if (res.mismatches == 0)
+        printf("[VERIFY] PASSED - All %.2f MB match the pattern!\n",
+               (double)res.st.bytes / MB);
+    else
+        printf("[VERIFY] FAILED - %llu mismatch(es) found!\n",
+               (unsigned long long)res.mismatches);
+    if (spec.dev) print_device(name, 0, &res.dev);
+    print_regions(name, &res);
+    print_page_cache(name, &res);
+
+    report_add(rep, &res);
+    return EXIT_SUCCESS;
+}
+
+/* Copy filename to dest at the same offsets; fdatasync is part of the timing */
+static int run_copy_phase(const char *filename, const char *dest, size_t size,
+                          const JobSpec *base, Report *rep) {
+    int src_fd = open(filename, O_RDONLY);
+    if (src_fd < 0) {
+        perror("open (copy source)");
+        return EXIT_FAILURE;
+    }
+    int dst_fd = open(dest, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (dst_fd < 0) {
+        perror("open (copy dest)");
+        close(src_fd);
+        return EXIT_FAILURE;
+    }
+
+    JobSpec spec  = *base;
+    spec.name     = "copy";
+    spec.rw       = RW_COPY;
+    spec.rate     = 0;
+    spec.progress = "COPY ";
+    spec.dst_fd   = dst_fd;
+
+    JobResult res;
+    int       err = run_job(src_fd, size, NULL, &spec, &res);
+    double    t0  = get_time_sec();
+    if (!err && fdatasync(dst_fd) != 0) {
+        perror("\nfdatasync (copy dest)");
+        err = -1;
+    }
+    close(src_fd);
+    close(dst_fd);
+    if (err) {
+        result_free(&res);
+        return EXIT_FAILURE;
+    }
+
+    res.elapsed += get_time_sec() - t0;
+    res.iops     = res.st.ops / res.elapsed;
+    res.mbps     = ((double)res.st.bytes / MB) / res.elapsed;
+    printf("\n[COPY]  Copied %.2f MB in %.3f sec => %.2f MB/s (%s, %d thread(s))\n",
+           (double)res.st.bytes / MB, res.elapsed, res.mbps,
+           res.spliced ? "splice fallback" : "copy_file_range", spec.qd);
+    if (spec.dev) print_device("copy", res.st.bytes, &res.dev);
+    print_regions("copy", &res);
+    report_add(rep, &res);
+    return EXIT_SUCCESS;
+}
+
+/* ------------------------------------------------------------------ */
+/* Burn-in mode                                                        */
+/* ------------------------------------------------------------------ */
+
+typedef struct {
+    int            fd;
+    size_t         size;
+    const uint8_t *img;
+    JobSpec        spec;
+    JobResult      res;
+    int            err;
+    pthread_t      tid;
+} AsyncJob;
+
+static void *async_job_main(void *arg) {
+    AsyncJob *a = arg;
+    a->err = run_job(a->fd, a->size, a->img, &a->spec, &a->res);
+    return NULL;
+}
+
+/*
+ * K write+verify passes over [0, size), pattern rotating through
+ * opt->patterns. Pass k+1's write runs concurrently with pass k's verify,
+ * fenced so that it only overwrites blocks the verifier has already checked;
+ * the device never sits idle between passes.
+ */
+static int run_burnin(const char *filename, size_t size, const HexPattern *pat,
+                      uint64_t hex_val, const Options *opt, const JobSpec *base, Report *rep) {
+    int wfd = open(filename, O_WRONLY | O_CREAT | O_DIRECT, 0644);
+    if (wfd < 0) {
+        perror("open (burnin write)");
+        return EXIT_FAILURE;
+    }
+    int rfd = open(filename, O_RDONLY | O_DIRECT);
+    if (rfd < 0) {
+        perror("open (burnin read)");
+        close(wfd);
+        return EXIT_FAILURE;
+    }
+
+    int          K        = opt->passes;
+    JobResult   *wres     = calloc((size_t)K, sizeof(JobResult));
+    JobResult   *vres     = calloc((size_t)K, sizeof(JobResult));
+    PatternKind *kind     = calloc((size_t)K, sizeof(PatternKind));
+    uint8_t     *cur_img  = NULL;
+    uint8_t     *next_img = NULL;
+    int          rc       = EXIT_SUCCESS;
+    double       t_start  = get_time_sec();
+
+    if (!wres || !vres || !kind) {
+        perror("calloc (burnin)");
+        free(wres);
+        free(vres);
+        free(kind);
+        close(wfd);
+        close(rfd);
+        return EXIT_FAILURE;
+    }
+    for (int k = 0; k < K; k++)
+        kind[k] = opt->patterns[k % opt->npatterns];
+
+    printf("[BURNIN] %d pass(es) over %.2f MB, patterns:", K, (double)size / MB);
+    for (int i = 0; i < opt->npatterns; i++) printf(" %s", pattern_names[opt->patterns[i]]);
+    printf("\n");
+
+    /* Pass 1 write runs on its own, every later write trails a verify */
+    JobSpec wspec = *base;
+    wspec.dev     = NULL;       /* writes overlap verifies; only the run total is meaningful */
+    wspec.name    = "burnin-write";
+    wspec.rw      = RW_WRITE;
+    wspec.progress = "WRITE";
+    cur_img = build_image(kind[0], pat, hex_val ^ 1, base->bs);
+    if (run_job(wfd, size, cur_img, &wspec, &wres[0]) != 0) rc = EXIT_FAILURE;
+    snprintf(wres[0].label, sizeof(wres[0].label), "write-%d", 1);
+
+    for (int k = 0; k < K && rc == EXIT_SUCCESS; k++) {
+        Fence fence;
+        atomic_init(&fence.done, 0);
+
+        AsyncJob verify = { .fd = rfd, .size = size, .img = cur_img, .spec = *base };
+        verify.spec.dev        = NULL;
+        verify.spec.name       = "burnin-verify";
+        verify.spec.rw         = RW_READ;
+        verify.spec.verify     = 1;
+        verify.spec.keep_going = 1;
+        verify.spec.progress   = k + 1 < K ? NULL : "VERIFY";
+        verify.spec.fence_out  = &fence;
+
+        printf("\n[PASS %d/%d] verify %s%s%s\n", k + 1, K, pattern_names[kind[k]],
+               k + 1 < K ? ", writing " : "", k + 1 < K ? pattern_names[kind[k + 1]] : "");
+        if (pthread_create(&verify.tid, NULL, async_job_main, &verify) != 0) {
+            perror("pthread_create (verify)");
+            rc = EXIT_FAILURE;
+            break;
+        }
+        if (k + 1 < K) {
+            next_img       = build_image(kind[k + 1], pat, hex_val ^ (uint64_t)(k + 2), base->bs);
+            wspec.fence_in = &fence;
+            wspec.progress = "WRITE";
+            if (run_job(wfd, size, next_img, &wspec, &wres[k + 1]) != 0) rc = EXIT_FAILURE;
+            snprintf(wres[k + 1].label, sizeof(wres[k + 1].label), "write-%d", k + 2);
+        }
+        pthread_join(verify.tid, NULL);
+        vres[k] = verify.res;
+        snprintf(vres[k].label, sizeof(vres[k].label), "verify-%d", k + 1);
+        if (verify.err) rc = EXIT_FAILURE;
+
+        free(cur_img);
+        cur_img  = next_img;
+        next_img = NULL;
+    }
+    free(cur_img);
+
+    uint64_t total_err = 0;
+    printf("\n\n[BURNIN] %-5s %-8s %12s %12s %12s\n",
+           "pass", "pattern", "write MB/s", "verify MB/s", "errors");
+    for (int k = 0; k < K; k++) {
+        printf("[BURNIN] %-5d %-8s %12.2f %12.2f %12llu\n", k + 1, pattern_names[kind[k]],
+               wres[k].mbps, vres[k].mbps, (unsigned long long)vres[k].mismatches);
+        total_err += vres[k].mismatches;
+        report_add(rep, &wres[k]);
+        report_add(rep, &vres[k]);
+    }
+    double t_total = get_time_sec() - t_start;
+    printf("[BURNIN] %.2f MB written and verified %d time(s) in %.3f sec\n",
+           (double)size / MB, K, t_total);
+    if (rc != EXIT_SUCCESS)
+        printf("[BURNIN] ABORTED - I/O error\n");
+    else if (total_err == 0)
+        printf("[BURNIN] PASSED - %d pass(es), no errors\n", K);
+    else
+        printf("[BURNIN] FAILED - %llu mismatched byte(s)\n", (unsigned long long)total_err);
+
+    free(wres); free(vres); free(kind);
+    close(wfd); close(rfd);
+    return rc;
+}
+
+/* ------------------------------------------------------------------ */
+/* Steady state                                                        */
+/* ------------------------------------------------------------------ */
+
+/*
+ * SNIA PTS steady-state test over the last n rounds of y: the data
+ * excursion (max - min) stays within SS_RANGE of the window average, and
+ * the least-squares line through the window moves by at most SS_SLOPE of
+ * the average from its first round to its last.
+ */
+static int steady_check(const double *y, int n, SteadyState *ss) {
+    double sum = 0, lo = y[0], hi = y[0];
+    for (int i = 0; i < n; i++) {
+        sum += y[i];
+        if (y[i] < lo) lo = y[i];
+        if (y[i] > hi) hi = y[i];
+    }
+    double avg = sum / n, xm = (n - 1) / 2.0, sxy = 0, sxx = 0;
+    for (int i = 0; i < n; i++) {
+        sxy += (i - xm) * (y[i] - avg);
+        sxx += (i - xm) * (i - xm);
+    }
+    ss->avg       = avg;
+    ss->range     = avg > 0 ? (hi - lo) / avg : 0.0;
+    ss->excursion = avg > 0 ? fabs(sxy / sxx) * (n - 1) / avg : 0.0;
+    return avg > 0 && ss->range <= SS_RANGE && ss->excursion <= SS_SLOPE;
+}
+
+/*
+ * Workload-independent preconditioning (opt->precondition sequential 128k
+ * write passes), then rounds of the base workload until the last
+ * opt->ss_window rounds pass steady_check() or opt->rounds run out.
+ */
+static int run_steady(const char *filename, size_t size, const HexPattern *pat,
+                      const Options *opt, const JobSpec *base, SteadyState *ss, Report *rep) {
+    if (base->bs > size) {
+        fprintf(stderr, "Block size %zu larger than size %zu\n", base->bs, size);
+        return EXIT_FAILURE;
+    }
+    int fd = open(filename, O_RDWR | O_CREAT | O_DIRECT, 0644);
+    if (fd < 0) {
+        perror("open (steady)");
+        return EXIT_FAILURE;
+    }
+
+    size_t   pc_bs   = size < 128 * 1024 ? size : 128 * 1024;
+    uint8_t *pat_img = build_pattern_image(pat, base->bs > pc_bs ? base->bs : pc_bs);
+    int      rc      = EXIT_SUCCESS;
+
+    memset(ss, 0, sizeof(*ss));
+    ss->window = opt->ss_window;
+
+    printf("[STEADY] %d precondition pass(es), then up to %d x %.1f sec rounds of %s "
+           "bs=%zu qd=%d\n", opt->precondition, opt->rounds, base->runtime,
+           rw_names[base->rw], base->bs, base->qd);
+    for (int p = 0; p < opt->precondition && rc == EXIT_SUCCESS; p++) {
+        JobSpec spec  = *base;
+        spec.name     = "precondition";
+        spec.rw       = RW_WRITE;
+        spec.bs       = pc_bs;
+        spec.runtime  = 0;
+        spec.rate     = 0;
+        spec.interval = 0;
+        spec.progress = "PRECN";
+        spec.slo      = NULL;      /* preconditioning is not measured */
+        JobResult res;
+        if (run_job(fd, size, pat_img, &spec, &res) != 0) {
+            result_free(&res);
+            rc = EXIT_FAILURE;
+            break;
+        }
+        snprintf(res.label, sizeof(res.label), "precond-%d", p + 1);
+        printf("\n[STEADY] precondition %d/%d: %.2f MB/s\n", p + 1, opt->precondition, res.mbps);
+        report_add(rep, &res);
+    }
+    if (rc == EXIT_SUCCESS && opt->precondition == 0 && !rw_is_write(base->rw) &&
+        prefill_file(fd, size, pat_img, pc_bs) != 0)
+        rc = EXIT_FAILURE;
+
+    double *iops = calloc((size_t)opt->rounds, sizeof(double));
+    if (!iops) {
+        perror("calloc (steady)");
+        rc = EXIT_FAILURE;
+    }
+    if (rc == EXIT_SUCCESS)
+        printf("\n[STEADY] %5s %12s %10s %10s %12s %8s %8s\n",
+               "round", "IOPS", "MB/s", "p99_us", "window_avg", "range%", "excur%");
+    for (int r = 0; r < opt->rounds && rc == EXIT_SUCCESS; r++) {
+        JobSpec spec = *base;
+        spec.name    = "round";
+        JobResult res;
+        if (run_job(fd, size, pat_img, &spec, &res) != 0) {
+            result_free(&res);
+            rc = EXIT_FAILURE;
+            break;
+        }
+        snprintf(res.label, sizeof(res.label), "round-%d", r + 1);
+        iops[r]    = res.iops;
+        ss->rounds = r + 1;
+        printf("[STEADY] %5d %12.0f %10.2f %10.1f", r + 1, res.iops, res.mbps,
+               hist_percentile(&res.st.lat, 99.0) / 1e3);
+        report_add(rep, &res);
+        if (r + 1 >= ss->window) {
+            ss->first   = r + 2 - ss->window;
+            ss->reached = steady_check(&iops[ss->first - 1], ss->window, ss);
+            printf(" %12.0f %8.1f %8.1f", ss->avg, 100.0 * ss->range, 100.0 * ss->excursion);
+        }
+        printf("\n");
+        fflush(stdout);
+        if (ss->reached) break;
+    }
+    free(iops);
+
+    if (rc == EXIT_SUCCESS) {
+        if (ss->reached)
+            printf("[STEADY] reached in rounds %d-%d: avg %.0f IOPS, range %.1f%% (<= %.0f%%), "
+                   "excursion %.1f%% (<= %.0f%%)\n", ss->first, ss->first + ss->window - 1,
+                   ss->avg, 100.0 * ss->range, 100.0 * SS_RANGE, 100.0 * ss->excursion,
+                   100.0 * SS_SLOPE);
+        else
+            printf("[STEADY] NOT reached after %d round(s); last window %d-%d: range %.1f%%, "
+                   "excursion %.1f%%\n", ss->rounds, ss->first, ss->first + ss->window - 1,
+                   100.0 * ss->range, 100.0 * ss->excursion);
+        rep->steady = ss;
+    }
+    free(pat_img);
+    close(fd);
+    return rc;
+}
+
+/* ------------------------------------------------------------------ */
+/* Queue-depth auto-tune                                               */
+/* ------------------------------------------------------------------ */
+
+static void tune_free(Tuner *t) {
+    free(t->n);
+    free(t->ok);
+    free(t->iops);
+    free(t->p99);
+    memset(t, 0, sizeof(*t));
+}
+
+/*
+ * One time-based job of the base workload with base->qd workers, the
+ * active depth steered by tune_step(). The operating point is the depth
+ * with the highest mean IOPS among those measured at least twice whose mean
+ * p99 stays within the target.
+ */
+static int run_tune(const char *filename, size_t size, const HexPattern *pat,
+                    const JobSpec *base, Tuner *t, Report *rep) {
+    if (base->bs > size) {
+        fprintf(stderr, "Block size %zu larger than size %zu\n", base->bs, size);
+        return EXIT_FAILURE;
+    }
+    int write = rw_is_write(base->rw);
+    int fd    = open(filename, (write ? O_RDWR | O_CREAT : O_RDWR) | O_DIRECT, 0644);
+    if (fd < 0 && !write && (errno == EACCES || errno == EROFS || errno == ENOENT))
+        fd = open(filename, O_RDONLY | O_DIRECT);
+    if (fd < 0) {
+        perror("open (tune)");
+        return EXIT_FAILURE;
+    }
+    uint8_t *pat_img = build_pattern_image(pat, base->bs);
+    if (!write && prefill_file(fd, size, pat_img, CHUNK_SIZE < size ? CHUNK_SIZE : size) != 0) {
+        close(fd);
+        free(pat_img);
+        return EXIT_FAILURE;
+    }
+
+    t->max_depth = base->qd;
+    t->depth     = 1;
+    t->n    = calloc((size_t)t->max_depth + 1, sizeof(int));
+    t->ok   = calloc((size_t)t->max_depth + 1, sizeof(int));
+    t->iops = calloc((size_t)t->max_depth + 1, sizeof(double));
+    t->p99  = calloc((size_t)t->max_depth + 1, sizeof(double));
+    if (!t->n || !t->ok || !t->iops || !t->p99) {
+        perror("calloc (tune)");
+        free(pat_img);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    JobSpec spec  = *base;
+    spec.name     = "tune";
+    spec.rate     = 0;        /* the depth is the knob, not the arrival rate */
+    spec.interval = base->interval > 0 ? base->interval : 0.5;
+    spec.tune     = t;
+    if (spec.runtime < 2 * spec.interval) {
+        fprintf(stderr, "tune mode needs --runtime of at least two %.1f sec intervals\n",
+                spec.interval);
+        free(pat_img);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    printf("[TUNE] %s bs=%zu, depth 1..%d, p99 target %.0f us, %.1f sec, %.1f sec steps\n",
+           rw_names[spec.rw], spec.bs, t->max_depth, t->target_us, spec.runtime, spec.interval);
+
+    JobResult res;
+    int       err = run_job(fd, size, pat_img, &spec, &res);
+    free(pat_img);
+    close(fd);
+    if (err) {
+        result_free(&res);
+        return EXIT_FAILURE;
+    }
+    report_add(rep, &res);
+
+    int best = 0, twice = 0;
+    printf("\n[TUNE] %5s %9s %7s %12s %10s\n", "depth", "intervals", "within", "IOPS", "p99_us");
+    for (int d = 1; d <= t->max_depth; d++) {
+        if (!t->n[d]) continue;
+        twice += t->n[d] >= 2;
+        double iops = t->iops[d] / t->n[d], p99 = t->p99[d] / t->n[d];
+        printf("[TUNE] %5d %9d %7d %12.0f %10.1f\n", d, t->n[d], t->ok[d], iops, p99);
+        if (t->n[d] >= 2 && p99 <= t->target_us &&
+            (!best || iops > t->iops[best] / t->n[best]))
+            best = d;
+    }
+    rep->tune      = t;
+    rep->tune_best = best;
+    if (best)
+        printf("[TUNE] operating point: depth %d => %.0f IOPS, p99 %.1f us (target %.0f us)\n",
+               best, t->iops[best] / t->n[best], t->p99[best] / t->n[best], t->target_us);
+    else if (!twice)
+        printf("[TUNE] no depth was measured twice in %.1f sec: raise --runtime\n", spec.runtime);
+    else
+        printf("[TUNE] no depth kept p99 within %.0f us over two intervals\n", t->target_us);
+    return EXIT_SUCCESS;
+}
+
+/* ------------------------------------------------------------------ */
+/* Core scaling                                                        */
+/* ------------------------------------------------------------------ */
+
+/*
+ * One per-core job for every entry of opt->cores_list (default 1, 2, 4, ...
+ * up to every allowed CPU), then the scaling table: IOPS per core, speedup
+ * over one core and efficiency (speedup / cores).
+ */
+static int run_cores(const char *filename, size_t size, const HexPattern *pat,
+                     const Options *opt, const JobSpec *base, Report *rep) {
+    int cpus[MAX_QD], ncpu = allowed_cpus(cpus, MAX_QD);
+    int list[MAX_SWEEP], n = 0;
+    if (opt->ncores) {
+        for (int i = 0; i < opt->ncores; i++) list[n++] = (int)opt->cores_list[i];
+    } else {
+        for (int c = 1; c < ncpu && n < MAX_SWEEP - 1; c *= 2) list[n++] = c;
+        list[n++] = ncpu > 0 ? ncpu : 1;
+    }
+    if (base->bs > size || size / base->bs < (size_t)list[n - 1]) {
+        fprintf(stderr, "Size %zu too small for %d slice(s) of %zu-byte blocks\n",
+                size, list[n - 1], base->bs);
+        return EXIT_FAILURE;
+    }
+
+    int write = rw_is_write(base->rw);
+    int fd    = open(filename, (write ? O_RDWR | O_CREAT : O_RDWR) | O_DIRECT, 0644);
+    if (fd < 0 && !write && (errno == EACCES || errno == EROFS || errno == ENOENT))
+        fd = open(filename, O_RDONLY | O_DIRECT);
+    if (fd < 0) {
+        perror("open (cores)");
+        return EXIT_FAILURE;
+    }
+    uint8_t *pat_img = build_pattern_image(pat, base->bs);
+    if (!write && prefill_file(fd, size, pat_img, CHUNK_SIZE < size ? CHUNK_SIZE : size) != 0) {
+        close(fd);
+        free(pat_img);
+        return EXIT_FAILURE;
+    }
+
+    printf("[CORES] %s bs=%zu, %d in flight per core, %.1f sec per step, %d CPU(s) allowed\n\n",
+           rw_names[base->rw], base->bs, base->qd, base->runtime, ncpu);
+    int     rc       = EXIT_SUCCESS;
+    int     first    = rep->nphases;
+    double *per_core = malloc(MAX_QD * sizeof(double));
+    if (!per_core) {
+        perror("malloc (cores)");
+        rc = EXIT_FAILURE;
+    }
+    for (int s = 0; s < n && rc == EXIT_SUCCESS; s++) {
+        int k = list[s];
+        if (k > ncpu)
+            printf("[CORES] %d core(s) > %d allowed CPU(s): running unpinned\n", k, ncpu);
+        JobSpec spec = *base;
+        spec.name    = "cores";
+        spec.rate    = 0;
+        JobResult res;
+        if (run_cores_job(fd, size, pat_img, &spec, k, k <= ncpu ? cpus : NULL, &res,
+                          per_core) != 0) {
+            result_free(&res);
+            rc = EXIT_FAILURE;
+            break;
+        }
+        snprintf(res.label, sizeof(res.label), "cores-%d", k);
+        double lo = per_core[0], hi = per_core[0];
+        for (int i = 1; i < k; i++) {
+            if (per_core[i] < lo) lo = per_core[i];
+            if (per_core[i] > hi) hi = per_core[i];
+        }
+        printf("[CORES] %3d core(s): %10.0f IOPS %9.2f MB/s  p99 %8.1f us  per core %.0f..%.0f\n",
+               k, res.iops, res.mbps, hist_percentile(&res.st.lat, 99.0) / 1e3, lo, hi);
+        fflush(stdout);
+        report_add(rep, &res);
+    }
+    free(per_core);
+    free(pat_img);
+    close(fd);
+
+    if (rc == EXIT_SUCCESS) {
+        printf("\n[SCALING] %5s %12s %10s %12s %8s %10s %10s\n",
+               "cores", "IOPS", "MB/s", "IOPS/core", "speedup", "efficiency", "p99_us");
+        for (int i = first; i < rep->nphases; i++) {
+            const JobResult *r = &rep->phases[i], *one = scaling_base(rep, r);
+            printf("[SCALING] %5d %12.0f %10.2f %12.0f", r->cores, r->iops, r->mbps,
+                   r->iops / r->cores);
+            if (one)
+                printf(" %8.2f %9.1f%%", r->iops / one->iops, 100.0 * r->iops / one->iops / r->cores);
+            else
+                printf(" %8s %10s", "-", "-");
+            printf(" %10.1f\n", hist_percentile(&r->st.lat, 99.0) / 1e3);
+        }
+    }
+    return rc;
+}
+
+/* ------------------------------------------------------------------ */
+/* Page cache comparison                                               */
+/* ------------------------------------------------------------------ */
+
+/*
+ * One sequential write pass and one read+verify pass of the base workload
+ * through each of O_DIRECT, plain buffered I/O and RWF_DONTCACHE, every
+ * pass starting with the file evicted. Each write pass starts from a
+ * truncated file, as in write mode: a filesystem may keep RWF_DONTCACHE
+ * pages of overwritten blocks. Buffered writes count the final fdatasync().
+ * The page cache is system wide, so other activity shows too.
+ */
+static int run_cache(const char *filename, size_t size, const uint8_t *pat_img,
+                     const JobSpec *base, Report *rep) {
+    static const char *names[][2] = {
+        { "direct-write", "direct-read" },
+        { "buffered-write", "buffered-read" },
+        { "dontcache-write", "dontcache-read" },
+    };
+    if (meminfo_cached() < 0) fprintf(stderr, "Cannot read /proc/meminfo: no page cache figures\n");
+    int first = rep->nphases;
+    for (int m = CACHE_DIRECT; m <= CACHE_DONTCACHE; m++) {
+        int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC | (m == CACHE_DIRECT ? O_DIRECT : 0),
+                      0644);
+        if (fd < 0) {
+            perror("open (cache)");
+            return EXIT_FAILURE;
+        }
+        int dc = m == CACHE_DONTCACHE ? dontcache_probe(fd) : 1;
+        if (dc < 0) {
+            close(fd);
+            return EXIT_FAILURE;
+        }
+        if (dc == 0) {
+            printf("[CACHE] RWF_DONTCACHE is not supported for %s (needs Linux 6.14+ and "
+                   "filesystem support): skipped\n", filename);
+            close(fd);
+            continue;
+        }
+        for (int pass = 0; pass < 2; pass++) {
+            JobSpec spec  = *base;
+            spec.name     = names[m][pass];
+            spec.rw       = pass ? RW_READ : RW_WRITE;
+            spec.verify   = pass;
+            spec.cache    = (CacheMode)m;
+            spec.meminfo  = 1;
+            spec.cores    = 0;
+            spec.progress = pass ? "READ " : "WRITE";
+            page_cache_evict(fd);
+
+            JobResult res;
+            if (run_job(fd, size, pat_img, &spec, &res) != 0) {
+                result_free(&res);
+                close(fd);
+                return EXIT_FAILURE;
+            }
+            printf("\n");
+            print_page_cache(spec.name, &res);
+            if (res.mismatches)
+                printf("[VERIFY] FAILED - %llu mismatch(es) found!\n",
+                       (unsigned long long)res.mismatches);
+            report_add(rep, &res);
+        }
+        page_cache_evict(fd);
+        close(fd);
+    }
+
+    printf("\n[CACHE] %-10s %12s %12s %16s %16s %16s\n", "io", "write MB/s", "read MB/s",
+           "write peak MB", "write after MB", "read after MB");
+    for (int i = first; i + 1 < rep->nphases; i += 2) {
+        const JobResult *w = &rep->phases[i], *r = &rep->phases[i + 1];
+        printf("[CACHE] %-10s %12.2f %12.2f %+16.2f %+16.2f %+16.2f\n",
+               cache_names[w->spec.cache], w->mbps, r->mbps, (double)w->cache_peak / MB,
+               (double)w->cache_after / MB, (double)r->cache_after / MB);
+    }
+    return EXIT_SUCCESS;
+}
+
+/* ------------------------------------------------------------------ */
+/* Trace decoder                                                       */
+/* ------------------------------------------------------------------ */
+
+/*
+ * snb_dit decode TRACE [CSV]: latency summary and log2 histogram per phase
+ * and op on stdout; with CSV every record is converted too ("-" = stdout,
+ * the summary then goes to stderr).
+ */
+#define TRACE_MAX_PHASES 65536   /* TraceRec.phase is 16 bits */
+
+typedef struct {
+    char     name[24];
+    LatHist  lat[RW_USER_TYPES + 1];
+    uint64_t bytes[RW_USER_TYPES + 1];
+    uint64_t errors[RW_USER_TYPES + 1];
+    uint64_t first_ns, last_ns;
+} TracePhase;
+
+/* Phases are allocated on first sight: a trace rarely has more than a few */
+static TracePhase *trace_phase_get(TracePhase **ph, unsigned id) {
+    if (!ph[id]) {
+        ph[id] = calloc(1, sizeof(TracePhase));
+        if (!ph[id]) return NULL;
+        for (int k = 0; k <= RW_USER_TYPES; k++) hist_init(&ph[id]->lat[k]);
+    }
+    return ph[id];
+}
+
+static void trace_phases_free(TracePhase **ph) {
+    for (int p = 0; p < TRACE_MAX_PHASES; p++) free(ph[p]);
+    free(ph);
+}
+
+static int trace_decode(int argc, char *argv[]) {
+    if (argc < 1 || argc > 2) {
+        fprintf(stderr, "Usage: snb_dit decode <trace> [csv|-]\n");
+        return EXIT_FAILURE;
+    }
+    FILE *in = fopen(argv[0], "rb");
+    if (!in) {
+        perror("fopen (trace)");
+        return EXIT_FAILURE;
+    }
+    char     magic[8];
+    uint32_t hdr[2];
+    if (fread(magic, 8, 1, in) != 1 || memcmp(magic, TRACE_MAGIC, 8) != 0 ||
+        fread(hdr, sizeof(hdr), 1, in) != 1 || hdr[0] != sizeof(TraceRec)) {
+        fprintf(stderr, "%s: not a snb_dit trace\n", argv[0]);
+        fclose(in);
+        return EXIT_FAILURE;
+    }
+
+    FILE *csv = NULL;
+    if (argc == 2) {
+        csv = strcmp(argv[1], "-") == 0 ? stdout : fopen(argv[1], "w");
+        if (!csv) {
+            perror("fopen (csv)");
+            fclose(in);
+            return EXIT_FAILURE;
+        }
+        fprintf(csv, "phase,thread,op,offset,len,submit_ns,complete_ns,lat_us,result\n");
+    }
+    FILE *out = csv == stdout ? stderr : stdout;
+
+    TracePhase **ph = calloc(TRACE_MAX_PHASES, sizeof(*ph));
+    if (!ph) {
+        perror("calloc (trace phases)");
+        fclose(in);
+        if (csv && csv != stdout) fclose(csv);
+        return EXIT_FAILURE;
+    }
+
+    TraceRec recs[1024];
+    size_t   n;
+    uint64_t total = 0, unknown = 0;
+    while ((n = fread(recs, sizeof(TraceRec), 1024, in)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            const TraceRec *r = &recs[i];
+            TracePhase     *p = trace_phase_get(ph, r->phase);
+            if (!p) {
+                perror("calloc (trace phase)");
+                trace_phases_free(ph);
+                fclose(in);
+                if (csv && csv != stdout) fclose(csv);
+                return EXIT_FAILURE;
+            }
+            if (r->op == TRACE_OP_PHASE) {
+                snprintf(p->name, sizeof(p->name), "%.23s", (const char *)&r->off);
+                continue;
+            }
+            /* Corrupt or from a newer writer: keep it out of the real ops */
+            if (r->op > RW_COPY) {
+                unknown++;
+                continue;
+            }
+            int op = r->op;
+            if (!p->first_ns || r->submit_ns < p->first_ns) p->first_ns = r->submit_ns;
+            if (r->complete_ns > p->last_ns) p->last_ns = r->complete_ns;
+            hist_add(&p->lat[op], r->complete_ns - r->submit_ns);
+            if (r->result < 0) p->errors[op]++;
+            else               p->bytes[op] += (uint64_t)r->result;
+            total++;
+            if (csv)
+                fprintf(csv, "%u,%u,%s,%llu,%u,%llu,%llu,%.3f,%d\n", r->phase, r->thread,
+                        rw_names[op],
+                        (unsigned long long)r->off, r->len,
+                        (unsigned long long)r->submit_ns, (unsigned long long)r->complete_ns,
+                        (r->complete_ns - r->submit_ns) / 1e3, r->result);
+        }
+    }
+    fclose(in);
+    if (csv && csv != stdout) fclose(csv);
+
+    fprintf(out, "%llu I/O record(s) in %s\n", (unsigned long long)total, argv[0]);
+    if (unknown)
+        fprintf(out, "%llu record(s) with an unknown op skipped\n", (unsigned long long)unknown);
+    for (int pi = 0; pi < TRACE_MAX_PHASES; pi++) {
+        TracePhase *p = ph[pi];
+        if (!p) continue;
+        for (int k = 0; k <= RW_USER_TYPES; k++) {
+            const LatHist *h = &p->lat[k];
+            if (!h->count) continue;
+            double secs = (p->last_ns - p->first_ns) / 1e9;
+            fprintf(out, "\nphase %d %s, %s: %llu ops, %.2f MB, %.0f IOPS, %llu error(s)\n",
+                    pi, p->name[0] ? p->name : "?", rw_names[k],
+                    (unsigned long long)h->count, (double)p->bytes[k] / MB,
+                    secs > 0 ? h->count / secs : 0.0, (unsigned long long)p->errors[k]);
+            fprintf(out, "  lat us: mean %.1f  p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+                    hist_mean(h) / 1e3, hist_percentile(h, 50.0) / 1e3,
+                    hist_percentile(h, 99.0) / 1e3, hist_percentile(h, 99.9) / 1e3,
+                    h->max_ns / 1e3);
+
+            /* Fold the log-linear buckets into powers of two of microseconds */
+            uint64_t bins[40] = { 0 }, peak = 0;
+            int      lo = 40, hi = 0;
+            for (int b = 0; b < HIST_BUCKETS; b++) {
+                if (!h->bucket[b]) continue;
+                uint64_t us  = hist_value(b) / 1000;
+                int      bin = 0;
+                while (bin < 39 && (1ull << bin) <= us) bin++;
+                bins[bin] += h->bucket[b];
+                if (bin < lo) lo = bin;
+                if (bin > hi) hi = bin;
+            }
+            for (int b = lo; b <= hi; b++) if (bins[b] > peak) peak = bins[b];
+            for (int b = lo; b <= hi; b++) {
+                int bar = peak ? (int)(bins[b] * 50 / peak) : 0;
+                fprintf(out, "  < %9llu us %10llu |%.*s\n", 1ull << b,
+                        (unsigned long long)bins[b], bar,
+                        "##################################################");
+            }
+        }
+    }
+    trace_phases_free(ph);
+    return EXIT_SUCCESS;
+}
+
+/* ------------------------------------------------------------------ */
+/* Report comparison                                                   */
+/* ------------------------------------------------------------------ */
+
+/*
+ * Just enough JSON to read our own --format=json reports back: a tree of
+ * nodes, object members carry their key.
+ */
+typedef struct JNode JNode;
+struct JNode {
+    char    type;     /* 'o'bject, 'a'rray, 's'tring, 'n'umber, 'b'ool, 'z' null */
+    char   *key;      /* member name inside an object */
+    char   *str;
+    double  num;
+    JNode  *kid;
+    int     nkid;
+};
+
+static void json_ws(const char **p) {
+    while (**p == ' ' || **p == '\t' || **p == '\n' || **p == '\r') (*p)++;
+}
+
+static char *json_parse_string(const char **p) {
+    const char *s   = ++*p;
+    char       *out = malloc(strlen(s) + 1), *o = out;
+    if (!out) {
+        perror("malloc (json)");
+        return NULL;
+    }
+    while (*s && *s != '"') {
+        if (*s == '\\' && s[1]) {
+            s++;
+            switch (*s) {
+            case 'n': *o++ = '\n'; break;
+            case 't': *o++ = '\t'; break;
+            case 'r': *o++ = '\r'; break;
+            case 'b': *o++ = '\b'; break;
+            case 'f': *o++ = '\f'; break;
+            case 'u': {
+                unsigned c = 0;
+                if (sscanf(s + 1, "%4x", &c) == 1 && strlen(s) > 4) s += 4;
+                *o++ = c < 0x80 ? (char)c : '?';
+                break;
+            }
+            default:  *o++ = *s; break;
+            }
+            s++;
+        } else {
+            *o++ = *s++;
+        }
+    }
+    *o = '\0';
+    if (*s != '"') {
+        free(out);
+        return NULL;
+    }
+    *p = s + 1;
+    return out;
+}
+
+static void json_free(JNode *n) {
+    for (int i = 0; i < n->nkid; i++) json_free(&n->kid[i]);
+    free(n->kid);
+    free(n->key);
+    free(n->str);
+}
+
+static int json_parse(const char **p, JNode *n) {
+    memset(n, 0, sizeof(*n));
+    json_ws(p);
+    char c = **p;
+    if (c == '{' || c == '[') {
+        n->type = c == '{' ? 'o' : 'a';
+        (*p)++;
+        json_ws(p);
+        if (**p == (c == '{' ? '}' : ']')) {
+            (*p)++;
+            return 0;
+        }
+        for (;;) {
+            char *key = NULL;
+            if (n->type == 'o') {
+                json_ws(p);
+                if (**p != '"' || !(key = json_parse_string(p))) return -1;
+                json_ws(p);
+                if (**p != ':') {
+                    free(key);
+                    return -1;
+                }
+                (*p)++;
+            }
+            JNode *kid = realloc(n->kid, (size_t)(n->nkid + 1) * sizeof(JNode));
+            if (!kid) {
+                perror("realloc (json)");
+                free(key);
+                return -1;
+            }
+            n->kid = kid;
+            if (json_parse(p, &n->kid[n->nkid]) != 0) {
+                free(key);
+                return -1;
+            }
+            n->kid[n->nkid++].key = key;
+            json_ws(p);
+            if (**p == ',') {
+                (*p)++;
+                continue;
+            }
+            if (**p != (n->type == 'o' ? '}' : ']')) return -1;
+            (*p)++;
+            return 0;
+        }
+    }
+    if (c == '"') {
+        n->type = 's';
+        return (n->str = json_parse_string(p)) ? 0 : -1;
+    }
+    if (strncmp(*p, "true", 4) == 0 || strncmp(*p, "false", 5) == 0) {
+        n->type = 'b';
+        n->num  = c == 't';
+        *p += c == 't' ? 4 : 5;
+        return 0;
+    }
+    if (strncmp(*p, "null", 4) == 0) {
+        n->type = 'z';
+        *p += 4;
+        return 0;
+    }
+    char *end;
+    n->type = 'n';
+    n->num  = strtod(*p, &end);
+    if (end == *p) return -1;
+    *p = end;
+    return 0;
+}
+
+static const JNode *json_get(const JNode *o, const char *key) {
+    for (int i = 0; o && o->type == 'o' && i < o->nkid; i++)
+        if (strcmp(o->kid[i].key, key) == 0) return &o->kid[i];
+    return NULL;
+}
+
+static double json_num(const JNode *o, const char *key) {
+    const JNode *n = json_get(o, key);
+    return n && n->type == 'n' ? n->num : NAN;
+}
+
+static const char *json_str(const JNode *o, const char *key) {
+    const JNode *n = json_get(o, key);
+    return n && n->type == 's' ? n->str : "";
+}
+
+static int json_load(const char *path, JNode *root) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    size_t cap = 1 << 16, len = 0, n;
+    char  *buf = malloc(cap);
+    while (buf && (n = fread(buf + len, 1, cap - len - 1, f)) > 0) {
+        len += n;
+        if (len + 1 == cap) {
+            char *nb = realloc(buf, cap *= 2);
+            if (!nb) free(buf);
+            buf = nb;
+        }
+    }
+    fclose(f);
+    if (!buf) {
+        perror(path);
+        return -1;
+    }
+    buf[len] = '\0';
+    const char *p  = buf;
+    int         rc = json_parse(&p, root);
+    free(buf);
+    if (rc != 0 || root->type != 'o' || strcmp(json_str(root, "tool"), "snb_dit") != 0) {
+        if (rc == 0) json_free(root);
+        fprintf(stderr, "%s: not a snb_dit JSON report\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+/* Compared metrics: where they live in a phase and in its interval samples */
+static const struct {
+    const char *name;
+    const char *lat;       /* key inside "lat_us", NULL = phase member */
+    const char *key;
+    const char *iv_key;
+    int         higher_better;
+} cmp_metrics[] = {
+    { "mbps",     NULL,    "mbps",  "mbps",    1 },
+    { "iops",     NULL,    "iops",  "iops",    1 },
+    { "mean_us",  "mean",  NULL,    "mean_us", 0 },
+    { "p99_us",   "p99",   NULL,    "p99_us",  0 },
+    { "p999_us",  "p99.9", NULL,    "p999_us", 0 },
+};
+#define NCMP_METRICS (int)(sizeof(cmp_metrics) / sizeof(cmp_metrics[0]))
+
+static double phase_value(const JNode *ph, int m) {
+    if (cmp_metrics[m].lat) return json_num(json_get(ph, "lat_us"), cmp_metrics[m].lat);
+    return json_num(ph, cmp_metrics[m].key);
+}
+
+static int same_point(const JNode *a, const JNode *b) {
+    return strcmp(json_str(a, "name"), json_str(b, "name")) == 0 &&
+           strcmp(json_str(a, "rw"), json_str(b, "rw")) == 0 &&
+           json_num(a, "bs") == json_num(b, "bs") && json_num(a, "qd") == json_num(b, "qd");
+}
+
+/* Samples of one metric */
+typedef struct {
+    int    n;
+    double mean, var;
+} Sample;
+
+static void sample_add(Sample *s, double v, double *sum, double *sq) {
+    if (isnan(v)) return;
+    s->n++;
+    *sum += v;
+    *sq  += v * v;
+}
+
+static void sample_done(Sample *s, double sum, double sq) {
+    s->mean = s->n ? sum / s->n : NAN;
+    s->var  = s->n > 1 ? fmax(0.0, (sq - sum * sum / s->n) / (s->n - 1)) : 0.0;
+}
+
+/*
+ * Every run of the point (--repeat) is one sample. A single run falls back
+ * to its interval samples for the variance, if it recorded any (--interval);
+ * those are correlated, so the test is optimistic.
+ */
+static void point_samples(const JNode *phases, const JNode *pt, int m, Sample *run, Sample *iv) {
+    double sum = 0, sq = 0, isum = 0, isq = 0;
+    memset(run, 0, sizeof(*run));
+    memset(iv, 0, sizeof(*iv));
+    for (int i = 0; i < phases->nkid; i++) {
+        const JNode *ph = &phases->kid[i];
+        if (!same_point(ph, pt)) continue;
+        sample_add(run, phase_value(ph, m), &sum, &sq);
+        const JNode *ivs = json_get(ph, "intervals");
+        for (int j = 0; ivs && j < ivs->nkid; j++)
+            sample_add(iv, json_num(&ivs->kid[j], cmp_metrics[m].iv_key), &isum, &isq);
+    }
+    sample_done(run, sum, sq);
+    sample_done(iv, isum, isq);
+}
+
+/* Welch's t-test at 95%: 1 = significant, 0 = not, -1 = no variance recorded */
+static int welch_significant(const Sample *a, const Sample *b) {
+    if (a->n < 2 || b->n < 2) return -1;
+    double va = a->var / a->n, vb = b->var / b->n;
+    if (va + vb <= 0) return a->mean != b->mean;
+    double t  = fabs(a->mean - b->mean) / sqrt(va + vb);
+    double df = (va + vb) * (va + vb) /
+                (va * va / (a->n - 1) + vb * vb / (b->n - 1));
+    return t > t975((int)df);
+}
+
+/*
+ * snb_dit compare BASE NEW [--threshold=PCT]: align the phases / sweep
+ * points of two JSON reports by name, rw, bs and qd and print the change of
+ * each metric. A change beyond the threshold in the bad direction is a
+ * REGRESSION when Welch's test finds it significant, "regression?" when
+ * neither side recorded any variance. Exit status EXIT_SLO on a regression.
+ */
+static int report_compare(int argc, char *argv[]) {
+    const char *files[2];
+    int         nfiles    = 0;
+    double      threshold = 5.0;
+    for (int i = 0; i < argc; i++) {
+        if (strncmp(argv[i], "--threshold=", 12) == 0)
+            threshold = atof(argv[i] + 12);
+        else if (nfiles < 2)
+            files[nfiles++] = argv[i];
+        else
+            nfiles = 3;
+    }
+    if (nfiles != 2 || threshold < 0) {
+        fprintf(stderr, "Usage: snb_dit compare <base.json> <new.json> [--threshold=PCT]\n");
+        return EXIT_FAILURE;
+    }
+
+    JNode root[2];
+    if (json_load(files[0], &root[0]) != 0) return EXIT_FAILURE;
+    if (json_load(files[1], &root[1]) != 0) {
+        json_free(&root[0]);
+        return EXIT_FAILURE;
+    }
+    const JNode *phases[2];
+    for (int k = 0; k < 2; k++) {
+        phases[k] = json_get(&root[k], "phases");
+        printf("%-4s: %s (%s, mode %s, %.0f bytes, %d phase(s))\n", k ? "new" : "base",
+               files[k], json_str(&root[k], "file"), json_str(&root[k], "mode"),
+               json_num(&root[k], "size"), phases[k] ? phases[k]->nkid : 0);
+    }
+    if (!phases[0] || !phases[1] || phases[0]->type != 'a' || phases[1]->type != 'a') {
+        fprintf(stderr, "compare: report without phases\n");
+        json_free(&root[0]);
+        json_free(&root[1]);
+        return EXIT_FAILURE;
+    }
+
+    printf("\n[COMPARE] %-12s %-9s %8s %5s %-8s %12s %12s %9s  %s\n",
+           "phase", "rw", "bs", "qd", "metric", "base", "new", "delta%", "verdict");
+    int regressions = 0, improvements = 0;
+    for (int k = 0; k < 2; k++) {
+        for (int i = 0; i < phases[k]->nkid; i++) {
+            const JNode *pt  = &phases[k]->kid[i];
+            int          dup = 0, other = 0;
+            for (int j = 0; j < i; j++) dup |= same_point(&phases[k]->kid[j], pt);
+            for (int j = 0; j < phases[!k]->nkid; j++) other |= same_point(&phases[!k]->kid[j], pt);
+            if (dup || (k == 1 && other)) continue;
+            if (!other) {
+                printf("[COMPARE] %-12s %-9s %8.0f %5.0f only in %s\n", json_str(pt, "name"),
+                       json_str(pt, "rw"), json_num(pt, "bs"), json_num(pt, "qd"),
+                       k ? "new" : "base");
+                continue;
+            }
+            for (int m = 0; m < NCMP_METRICS; m++) {
+                Sample a, b, ai, bi;
+                point_samples(phases[0], pt, m, &a, &ai);
+                point_samples(phases[1], pt, m, &b, &bi);
+                if (a.n == 0 || b.n == 0) continue;
+                int sig = welch_significant(&a, &b);
+                if (sig < 0) sig = welch_significant(&ai, &bi);
+                double delta = a.mean != 0 ? 100.0 * (b.mean - a.mean) / a.mean : 0.0;
+                double worse = cmp_metrics[m].higher_better ? -delta : delta;
+                const char *verdict = "";
+                if (worse > threshold && sig != 0) {
+                    verdict = sig > 0 ? "REGRESSION" : "regression?";
+                    regressions += sig > 0;
+                } else if (-worse > threshold && sig != 0) {
+                    verdict = sig > 0 ? "improved" : "improved?";
+                    improvements += sig > 0;
+                } else if (fabs(delta) > threshold) {
+                    verdict = "noise";
+                }
+                if (m == 0)
+                    printf("[COMPARE] %-12s %-9s %8.0f %5.0f ", json_str(pt, "name"),
+                           json_str(pt, "rw"), json_num(pt, "bs"), json_num(pt, "qd"));
+                else
+                    printf("[COMPARE] %-12s %-9s %8s %5s ", "", "", "", "");
+                printf("%-8s %12.2f %12.2f %+8.1f%%  %s\n", cmp_metrics[m].name, a.mean,
+                       b.mean, delta, verdict);
+            }
+        }
+    }
+    printf("\n[COMPARE] %d significant regression(s), %d improvement(s) beyond %.1f%%\n",
+           regressions, improvements, threshold);
+    json_free(&root[0]);
+    json_free(&root[1]);
+    return regressions ? EXIT_SLO : EXIT_SUCCESS;
+}
+
+/* ------------------------------------------------------------------ */
+/* Surface scan                                                        */
+/* ------------------------------------------------------------------ */
+
+static int scan_class(const ScanLog *s, uint64_t ns) {
+    int c = 0;
+    while (c < s->nclasses && ns >= s->class_ns[c]) c++;
+    return c;
+}
+
+/* Extend the last slow range or start a new one */
+static void scan_range(ScanLog *s, uint64_t off, size_t len, uint64_t ns, int cls) {
+    SlowRange *last = s->nranges ? &s->ranges[s->nranges - 1] : NULL;
+    if (last && last->end == off) {
+        last->end = off + len;
+        if (ns > last->max_ns) last->max_ns = ns;
+        if (cls > last->cls) last->cls = cls;
+        return;
+    }
+    if (s->nranges == s->rcap) {
+        s->rcap   = s->rcap ? s->rcap * 2 : 64;
+        s->ranges = realloc(s->ranges, (size_t)s->rcap * sizeof(SlowRange));
+        if (!s->ranges) {
+            perror("realloc (scan ranges)");
+            exit(EXIT_FAILURE);
+        }
+    }
+    s->ranges[s->nranges++] = (SlowRange){ off, off + len, ns, cls };
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * badblocks-style read scan graded by latency: one sequential pass with
+ * large blocks, failing sectors isolated through the error map, then
+ * every block slower than the first class re-read one logical block at a
+ * time so slow sectors are located precisely. Sectors of fast blocks count
+ * in the fastest class.
+ */
+static int run_scan(const char *filename, size_t size, const JobSpec *base,
+                    ScanLog *scan, Report *rep) {
+    int fd = open(filename, O_RDONLY | O_DIRECT);
+    if (fd < 0) {
+        perror("open (scan)");
+        return EXIT_FAILURE;
+    }
+
+    ErrorMap *errors = base->errors;
+    errors->recover  = 1;        /* a scan always maps failing sectors */
+    pthread_mutex_init(&scan->lock, NULL);
+
+    JobSpec spec  = *base;
+    spec.name     = "scan";
+    spec.rw       = RW_READ;
+    spec.runtime  = 0;
+    spec.verify   = 0;
+    spec.scan     = scan;
+    spec.progress = "SCAN ";
+
+    JobResult res;
+    int       err = run_job(fd, size, NULL, &spec, &res);
+    if (err) {
+        result_free(&res);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    printf("\n[SCAN]  Read %.2f MB in %.3f sec => %.2f MB/s, %d slow block(s)\n",
+           (double)res.st.bytes / MB, res.elapsed, res.mbps, scan->nblocks);
+    report_add(rep, &res);
+
+    /* Re-read slow blocks in offset order, one logical block per I/O */
+    size_t   sec = scan->sector;
+    uint8_t *buf;
+    if (posix_memalign((void **)&buf, ALIGNMENT, sec) != 0) {
+        perror("posix_memalign (scan)");
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    uint64_t *order = NULL;
+    if (scan->nblocks > 0) {
+        order = malloc((size_t)scan->nblocks * sizeof(uint64_t));
+        if (!order) {
+            perror("malloc (scan)");
+            free(buf);
+            close(fd);
+            return EXIT_FAILURE;
+        }
+        memcpy(order, scan->blocks, (size_t)scan->nblocks * sizeof(uint64_t));
+        qsort(order, (size_t)scan->nblocks, sizeof(uint64_t), cmp_u64);
+    }
+
+    uint64_t reread = 0;
+    for (int i = 0; i < scan->nblocks; i++) {
+        uint64_t blk_end = order[i] + spec.bs < size ? order[i] + spec.bs : size;
+        for (uint64_t off = order[i]; off < blk_end; off += sec) {
+            uint64_t s, e;
+            if (errmap_next(errors, off, off + sec, &s, &e)) continue;
+            uint64_t t0 = get_time_ns();
+            ssize_t  r  = pread(fd, buf, sec, (off_t)off);
+            uint64_t ns = get_time_ns() - t0;
+            if (r != (ssize_t)sec) {
+                errmap_add(errors, off, off + sec, RW_READ, r < 0 ? errno : EIO);
+                continue;
+            }
+            int cls = scan_class(scan, ns);
+            scan->sectors[cls]++;
+            reread++;
+            if (cls > 0) scan_range(scan, off, sec, ns, cls);
+        }
+        print_progress("RESCN", (size_t)(i + 1), (size_t)scan->nblocks);
+    }
+    free(order);
+    free(buf);
+    close(fd);
+
+    uint64_t total = (size + sec - 1) / sec, bad = 0;
+    for (int i = 0; i < errors->nranges; i++)
+        if (errors->ranges[i].err)
+            bad += (errors->ranges[i].end - errors->ranges[i].start + sec - 1) / sec;
+    scan->sectors[scan->nclasses + 1] = bad;
+    scan->sectors[0] += total > reread + bad ? total - reread - bad : 0;
+
+    printf("%s[SCAN]  %-12s %14s\n", scan->nblocks ? "\n" : "", "class", "sectors");
+    for (int c = 0; c <= scan->nclasses; c++) {
+        char label[32];
+        if (c < scan->nclasses)
+            snprintf(label, sizeof(label), "< %g ms", scan->class_ns[c] / 1e6);
+        else
+            snprintf(label, sizeof(label), ">= %g ms", scan->class_ns[c - 1] / 1e6);
+        printf("[SCAN]  %-12s %14llu\n", label, (unsigned long long)scan->sectors[c]);
+    }
+    printf("[SCAN]  %-12s %14llu\n", "error", (unsigned long long)bad);
+    for (int i = 0; i < scan->nranges; i++) {
+        const SlowRange *r = &scan->ranges[i];
+        printf("[SCAN]  slow %llu - %llu (%llu sector(s)), max %.3f ms\n",
+               (unsigned long long)r->start, (unsigned long long)r->end,
+               (unsigned long long)((r->end - r->start) / sec), r->max_ns / 1e6);
+    }
+    rep->scan = scan;
+    return EXIT_SUCCESS;
+}
+
+/* Between --repeat runs: optional page cache drop, then the cooldown */
+static void repeat_settle(const Options *opt) {
+    if (opt->drop_caches) {
+        sync();
+        int fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+        if (fd < 0 || write(fd, "3\n", 2) != 2)
+            perror("\n[REPEAT] drop_caches");
+        if (fd >= 0) close(fd);
+    }
+    if (opt->cooldown > 0) {
+        printf("\n[REPEAT] cooling down %.1f sec\n", opt->cooldown);
+        fflush(stdout);
+        usleep((useconds_t)(opt->cooldown * 1e6));
+    }
+}
+
+/* Logical sector size of a block device, ALIGNMENT for anything else */
+static size_t logical_block_size(const char *filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return ALIGNMENT;
+    int         lbs = 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISBLK(st.st_mode) || ioctl(fd, BLKSSZGET, &lbs) != 0 ||
+        lbs < ALIGNMENT)
+        lbs = ALIGNMENT;
+    close(fd);
+    return (size_t)lbs;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "decode") == 0)
+        return trace_decode(argc - 2, argv + 2);
+    if (argc >= 2 && strcmp(argv[1], "compare") == 0)
+        return report_compare(argc - 2, argv + 2);
+
+    Options opt;
+    parse_options(argc, argv, &opt);
+    if (argc - optind != 4) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const char *filename  = argv[optind];
+    size_t       size     = (size_t)strtoull(argv[optind + 1], NULL, 10);
+    const char  *mode     = argv[optind + 2];
+    uint64_t     hex_val  = parse_hex(argv[optind + 3]);
+
+    /* Ensure size is a multiple of ALIGNMENT for O_DIRECT */
+    if (size % ALIGNMENT != 0) {
+        fprintf(stderr, "Size must be a multiple of %d for O_DIRECT\n", ALIGNMENT);
+        return EXIT_FAILURE;
+    }
+
+    /* Build the packed HexPattern from parsed hex value */
+    HexPattern pat;
+    pat.pattern8  = (uint8_t) (hex_val & 0xFF);
+    pat.pattern16 = (uint16_t)(hex_val & 0xFFFF);
+    pat.pattern32 = (uint32_t)(hex_val & 0xFFFFFFFF);
+    pat.pattern64 = hex_val;
+
+    printf("=== Direct I/O Pattern Test ===\n");
+    printf("File    : %s\n", filename);
+    printf("Size    : %zu bytes (%.2f MB)\n", size, (double)size / MB);
+    printf("Mode    : %s\n", mode);
+    printf("Pattern : 0x%llX\n", (unsigned long long)hex_val);
+    printf("Pattern structure (packed, %zu bytes):\n", sizeof(HexPattern));
+    printf("  pattern8  = 0x%02X\n", pat.pattern8);
+    printf("  pattern16 = 0x%04X\n", pat.pattern16);
+    printf("  pattern32 = 0x%08X\n", pat.pattern32);
+    printf("  pattern64 = 0x%016llX\n", (unsigned long long)pat.pattern64);
+    printf("Clock   : %s\n", clock_init(opt.clock));
+
+    Report rep;
+    report_init(&rep, filename, size, mode, hex_val);
+    int rc = EXIT_SUCCESS;
+
+    ErrorMap errors;
+    errmap_init(&errors, opt.on_error_continue, opt.retries, opt.retry_delay_ms,
+                opt.isolate_bs ? opt.isolate_bs : logical_block_size(filename));
+
+    SkipTree skip = { 0 };
+    if (opt.skip_list) {
+        if (skiptree_load(&skip, opt.skip_list) != 0) return EXIT_FAILURE;
+        printf("Skip    : %d range(s), %llu bytes from %s\n", skip.n,
+               (unsigned long long)skiptree_bytes(&skip), opt.skip_list);
+    }
+
+    Device      dev;
+    DevCounters dev0;
+    if (opt.device_stats) {
+        if (device_open(&dev, filename) != 0) {
+            fprintf(stderr, "No block device found for %s, --device-stats ignored\n", filename);
+            opt.device_stats = 0;
+        } else {
+            device_read(&dev, &dev0);
+            printf("Device  : %s (%u:%u)%s%s%s\n", dev.name, dev.maj, dev.min,
+                   dev0.valid ? ", diskstats" : "", dev0.smart ? ", NVMe SMART" : "",
+                   dev0.media ? ", OCP media writes" : "");
+        }
+    }
+
+    ScanLog     scan = { 0 };
+    SteadyState steady;
+    Tuner       tune = { 0 };
+    FILE       *slow_out = NULL;
+    if (opt.slow_us > 0) {
+        slow_out = opt.slow_out ? fopen(opt.slow_out, "a") : stdout;
+        if (!slow_out) {
+            perror("fopen (slow-out)");
+            return EXIT_FAILURE;
+        }
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = slow_signal;
+        sa.sa_flags   = SA_RESTART;
+        sigaction(SIGUSR1, &sa, NULL);
+        printf("Slow    : I/Os >= %.0f us, %d kept per worker -> %s (SIGUSR1 dumps, pid %d)\n",
+               opt.slow_us, opt.slow_ring, opt.slow_out ? opt.slow_out : "stdout",
+               (int)getpid());
+    }
+
+    Tracer tracer;
+    if (opt.trace) {
+        if (trace_open(&tracer, opt.trace) != 0) return EXIT_FAILURE;
+        printf("Trace   : %s (%zu-byte records)\n", opt.trace, sizeof(TraceRec));
+    }
+
+    for (int run = 1; run <= opt.repeat && rc == EXIT_SUCCESS; run++) {
+        int first = rep.nphases;
+        if (opt.repeat > 1) {
+            if (run > 1) repeat_settle(&opt);
+            printf("\n[REPEAT] run %d/%d\n", run, opt.repeat);
+        }
+        if (strcmp(mode, "sweep") == 0) {
+            printf("\n");
+            rc = run_sweep(filename, size, &pat, &opt, slow_out, opt.trace ? &tracer : NULL, &rep);
+        } else if (strcmp(mode, "steady") == 0 || strcmp(mode, "tune") == 0 ||
+                   strcmp(mode, "cores") == 0) {
+            int     tuning = strcmp(mode, "tune") == 0;
+            JobSpec base = {
+                .rw       = opt.rw,
+                .bs       = opt.bs_list[0],
+                .qd       = opt.qd_set ? (int)opt.qd_list[0] : tuning ? 64 :
+                            strcmp(mode, "cores") == 0 ? 32 : 1,
+                .runtime  = opt.runtime,
+                .rate     = opt.rate,
+                .interval = opt.interval,
+                .errors   = &errors,
+                .skip     = &skip,
+                .dev      = opt.device_stats ? &dev : NULL,
+                .slow_ns  = (uint64_t)(opt.slow_us * 1e3),
+                .slow_ring = opt.slow_ring,
+                .slow_out = slow_out,
+                .trace    = opt.trace ? &tracer : NULL,
+                .regions  = opt.regions,
+                .slo      = slo_active(&opt.slo) ? &opt.slo : NULL,
+                .link     = strcmp(mode, "cores") == 0 ? opt.link : LINK_NONE,
+                .buf_ring = strcmp(mode, "cores") == 0 ? opt.buf_ring : 0,
+            };
+            printf("\n");
+            if (strcmp(mode, "cores") == 0) {
+                rc = run_cores(filename, size, &pat, &opt, &base, &rep);
+            } else if (!tuning) {
+                rc = run_steady(filename, size, &pat, &opt, &base, &steady, &rep);
+            } else if (opt.target_p99 <= 0) {
+                fprintf(stderr, "tune mode requires --target-p99=USEC\n");
+                rc = EXIT_FAILURE;
+            } else if (opt.repeat > 1) {
+                /* One Tuner backs the report's depth table */
+                fprintf(stderr, "tune mode does not support --repeat\n");
+                rc = EXIT_FAILURE;
+            } else {
+                tune_free(&tune);
+                tune.target_us = opt.target_p99;
+                rc = run_tune(filename, size, &pat, &base, &tune, &rep);
+            }
+        } else {
+            /* Phases default to the legacy single 4 MB stream */
+            JobSpec base = {
+                .bs       = opt.bs_set ? opt.bs_list[0] : (size_t)CHUNK_SIZE,
+                .qd       = opt.qd_set ? (int)opt.qd_list[0] : 1,
+                .rate     = opt.rate,
+                .interval = opt.interval,
+                .errors   = &errors,
+                .skip     = &skip,
+                .dev      = opt.device_stats ? &dev : NULL,
+                .slow_ns  = (uint64_t)(opt.slow_us * 1e3),
+                .slow_ring = opt.slow_ring,
+                .slow_out = slow_out,
+                .trace    = opt.trace ? &tracer : NULL,
+                .regions  = opt.regions,
+                .slo      = slo_active(&opt.slo) ? &opt.slo : NULL,
+                .cores    = opt.ncores ? (int)opt.cores_list[0] :
+                            opt.link || opt.buf_ring ? 1 : 0,
+                .steal_unit = opt.steal_unit,
+                .link     = opt.link,
+                .buf_ring = opt.buf_ring,
+                .cache    = opt.cache,
+                .meminfo  = opt.cache != CACHE_DIRECT,
+            };
+
+            /*
+             * Track written blocks for random writes, which may leave holes, or
+             * when --bitmap asks for it; a sequential pass writes every block. A
+             * random write phase extends a compatible saved map; a read-only run
+             * verifies what it lists.
+             */
+            int      writes = strcmp(mode, "write") == 0 || strcmp(mode, "readwrite") == 0;
+            if (opt.link && !writes) {
+                fprintf(stderr, "--link needs a write phase (write or readwrite mode)\n");
+                return EXIT_FAILURE;
+            }
+            if (opt.cache && !writes && strcmp(mode, "read") != 0) {
+                fprintf(stderr, "--cache applies to read, write and readwrite mode\n");
+                return EXIT_FAILURE;
+            }
+            BlockMap written;
+            int      have_map = 0;
+            if (writes && opt.rw == RW_RANDWRITE) {
+                base.rw      = RW_RANDWRITE;
+                base.runtime = opt.runtime_set ? opt.runtime : 0;
+            }
+            if (opt.bitmap && (strcmp(mode, "read") == 0 || (writes && base.rw == RW_RANDWRITE)) &&
+                blockmap_load(&written, opt.bitmap) == 0) {
+                if (written.size != size || written.pattern != hex_val ||
+                    (writes && opt.bs_set && written.bs != base.bs)) {
+                    fprintf(stderr, "%s: recorded for size %zu, bs %zu, pattern 0x%llX\n",
+                            opt.bitmap, written.size, written.bs,
+                            (unsigned long long)written.pattern);
+                    free(written.words);
+                    return EXIT_FAILURE;
+                }
+                base.bs  = written.bs;
+                have_map = 1;
+            } else if (opt.bitmap && strcmp(mode, "read") == 0) {
+                fprintf(stderr, "Cannot load block map %s\n", opt.bitmap);
+                return EXIT_FAILURE;
+            } else if (writes && (opt.bitmap || base.rw == RW_RANDWRITE)) {
+                blockmap_init(&written, size, base.bs, hex_val);
+                have_map = 1;
+            }
+            if (have_map) {
+                base.written = &written;
+                printf("Bitmap  : %llu of %llu block(s) written, generation %llu\n",
+                       (unsigned long long)blockmap_count(&written),
+                       (unsigned long long)written.nblocks, (unsigned long long)written.gen);
+            }
+            if (base.cores)
+                printf("Buffer  : %.2f MB x %d in flight x %d core(s), io_uring%s%s%s\n\n",
+                       (double)base.bs / MB, base.qd, base.cores,
+                       base.link ? ", writes linked to " : "", base.link ? link_names[base.link] : "",
+                       base.buf_ring ? ", reads from a provided buffer ring" : "");
+            else
+                printf("Buffer  : %.2f MB x %d worker(s)%s%s\n\n", (double)base.bs / MB, base.qd,
+                       base.cache ? ", page cache: " : "", base.cache ? cache_names[base.cache] : "");
+
+            /* Pattern image: one chunk plus one block of periodic overhang */
+            uint8_t *pat_img = build_pattern_image(&pat, base.bs);
+            dump_hex(pat_img, CHUNK_SIZE, "Pattern buffer");
+
+            if (writes) {
+                rc = run_write_phase(filename, size, pat_img, &base, &rep);
+                if (rc == EXIT_SUCCESS && opt.bitmap && blockmap_save(&written, opt.bitmap) != 0)
+                    rc = EXIT_FAILURE;
+            }
+            if (rc == EXIT_SUCCESS && (strcmp(mode, "read") == 0 || strcmp(mode, "readwrite") == 0))
+                rc = run_read_phase(filename, size, pat_img, &base, "read", &rep);
+            if (have_map) free(written.words);
+
+            if (strcmp(mode, "burnin") == 0)
+                rc = run_burnin(filename, size, &pat, hex_val, &opt, &base, &rep);
+
+            if (strcmp(mode, "cache") == 0)
+                rc = run_cache(filename, size, pat_img, &base, &rep);
+
+            if (strcmp(mode, "scan") == 0) {
+                free(scan.blocks);
+                free(scan.ranges);
+                memset(&scan, 0, sizeof(scan));
+                scan.nclasses = opt.nclasses;
+                scan.sector   = errors.isolate_bs;
+                for (int c = 0; c < opt.nclasses; c++)
+                    scan.class_ns[c] = (uint64_t)(opt.classes_ms[c] * 1e6);
+                rc = run_scan(filename, size, &base, &scan, &rep);
+            }
+
+            if (strcmp(mode, "copy") == 0) {
+                if (!opt.dest) {
+                    fprintf(stderr, "copy mode requires --dest=FILE\n");
+                    rc = EXIT_FAILURE;
+                }
+                if (rc == EXIT_SUCCESS)
+                    rc = run_write_phase(filename, size, pat_img, &base, &rep);
+                if (rc == EXIT_SUCCESS)
+                    rc = run_copy_phase(filename, opt.dest, size, &base, &rep);
+                if (rc == EXIT_SUCCESS)
+                    rc = run_read_phase(opt.dest, size, pat_img, &base, "verify", &rep);
+            }
+
+            free(pat_img);
+        }
+        for (int i = first; opt.repeat > 1 && i < rep.nphases; i++)
+            rep.phases[i].run = run;
+    }
+    if (rc == EXIT_SUCCESS && opt.repeat > 1) {
+        rep.repeat = opt.repeat;
+        printf("\n");
+        print_repeat(&rep);
+    }
+
+    if (opt.device_stats) {
+        DevCounters dev1;
+        device_read(&dev, &dev1);
+        device_delta(&rep.dev, &dev0, &dev1);
+        rep.have_dev = 1;
+        for (int i = 0; i < rep.nphases; i++)
+            if (rw_is_write(rep.phases[i].spec.rw) || rep.phases[i].spec.rw == RW_COPY)
+                rep.host_written += rep.phases[i].st.bytes;
+        printf("\n");
+        print_device("run", rep.host_written, &rep.dev);
+    }
+
+    if (errors.recover || errmap_io_ranges(&errors)) {
+        rep.errors = &errors;
+        print_error_map(&errors);
+        if (errmap_io_ranges(&errors) && rc == EXIT_SUCCESS) rc = EXIT_FAILURE;
+    }
+    if (opt.badblocks_out && write_badblocks(opt.badblocks_out, &errors, &skip) != 0)
+        rc = EXIT_FAILURE;
+
+    /* Verdict: I/O errors outrank data mismatches, which outrank missed thresholds */
+    if (rc == EXIT_SUCCESS) {
+        for (int i = 0; i < rep.nphases; i++)
+            if (rep.phases[i].mismatches) rc = EXIT_VERIFY;
+    }
+    if (slo_active(&opt.slo)) {
+        int failed = 0;
+        rep.slo = &opt.slo;
+        printf("\n");
+        for (int i = 0; i < rep.nphases; i++) {
+            const JobResult *r = &rep.phases[i];
+            if (!r->spec.slo || (!r->slo_miss && !r->slo_iv)) continue;
+            printf("[SLO] %-12s MISSED: %s", r->label, r->slo_why);
+            if (r->slo_iv)
+                printf("%s%d of %d interval(s)", r->slo_miss ? "; " : "", r->slo_iv, r->niv);
+            printf("\n");
+            failed++;
+        }
+        if (failed)
+            printf("[SLO] FAILED - %d phase(s) missed a performance threshold\n", failed);
+        else
+            printf("[SLO] PASSED - every phase%s within thresholds\n",
+                   opt.interval > 0 ? " and interval" : "");
+        if (failed && rc == EXIT_SUCCESS) rc = EXIT_SLO;
+    }
+
+    if (opt.heatmap && write_heatmap(opt.heatmap, &rep) != 0) rc = EXIT_FAILURE;
+    if (opt.format_set || opt.output)
+        if (report_write(&rep, &opt) != 0) rc = EXIT_FAILURE;
+
+    if (slow_out && slow_out != stdout) fclose(slow_out);
+    if (opt.trace) {
+        trace_close(&tracer);
+        printf("[TRACE] %llu record(s) written to %s, %llu buffer stall(s)\n",
+               (unsigned long long)atomic_load(&tracer.records), opt.trace,
+               (unsigned long long)atomic_load(&tracer.stalls));
+        if (atomic_load(&tracer.failed)) rc = EXIT_FAILURE;
+    }
+    report_free(&rep);
+    errmap_free(&errors);
+    free(scan.blocks);
+    free(scan.ranges);
+    tune_free(&tune);
+    skiptree_free(&skip);
+    return rc;
+}